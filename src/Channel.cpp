@@ -25,6 +25,10 @@
 #include <complex>
 #include <algorithm>
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <string.h>
 
 #include "Channel.h"
 #include "timestamp.h"
@@ -34,7 +38,8 @@
 #include "myexception.h"
 #include "PHY.h"
 #include "Terminal.h"
-#include "Standard.h"
+#include "SimContext.h"
+#include "Contention.h"
 
 // Channel model parameters
 valarray<double> tapsPow_A{ 0.000000};
@@ -70,126 +75,191 @@ template <class T> ostream& operator << (ostream& os, const valarray<T>& x) {
 }
 
 
+/*
+ * Jakes class
+ *
+ * Performs Jakes' method
+ */
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+// number of oscillators processed at once
+const unsigned jakes_simd_width = 4;
+
 ////////////////////////////////////////////////////////////////////////////////
-// class recalc_interference                                                  //
-//                                                                            //
-// function-like object                                                       //
-// recalculates interference when a new packet is added to channel.           //
+// cos4                                                                       //
 //                                                                            //
+// cosine of four doubles. The argument is reduced to [-pi/4,pi/4] with a     //
+// three-part representation of pi/2 (accurate for |x| < 2^19*pi/2) and the   //
+// polynomial approximations of the Cephes library are employed.              //
 ////////////////////////////////////////////////////////////////////////////////
-class recalc_interference {
-  map<term_pair,double> path_loss;
-  MPDU pack;
-  double interf;
-
-public:
-  recalc_interference (
-   const map<term_pair,double>& pl, // map with all possible links and path loss
-   const MPDU& p                    // new packet added to channel
-   ) : path_loss(pl), pack(p) {interf = 0;}
+static inline __m256d cos4(__m256d x) {
+	const __m256d two_over_pi = _mm256_set1_pd(6.36619772367581382433e-01);
+	const __m256d pio2_1 = _mm256_set1_pd(1.57079632673412561417e+00);
+	const __m256d pio2_2 = _mm256_set1_pd(6.07710050630396597660e-11);
+	const __m256d pio2_3 = _mm256_set1_pd(2.02226624871116645580e-21);
+
+	// x = n*pi/2 + r
+	__m256d n = _mm256_round_pd(_mm256_mul_pd(x, two_over_pi),
+			_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256d r = _mm256_sub_pd(x, _mm256_mul_pd(n, pio2_1));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(n, pio2_2));
+	r = _mm256_sub_pd(r, _mm256_mul_pd(n, pio2_3));
+	__m256d z = _mm256_mul_pd(r, r);
+
+	// sin(r)
+	__m256d ps = _mm256_set1_pd(1.58962301576546568060e-10);
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-2.50507477628578072866e-8));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(2.75573136213857245213e-6));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-1.98412698295895385996e-4));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(8.33333333332211858878e-3));
+	ps = _mm256_add_pd(_mm256_mul_pd(ps, z), _mm256_set1_pd(-1.66666666666666307295e-1));
+	__m256d sinr = _mm256_add_pd(r, _mm256_mul_pd(_mm256_mul_pd(r, z), ps));
+
+	// cos(r)
+	__m256d pc = _mm256_set1_pd(-1.13585365213876817300e-11);
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(2.08757008419747316778e-9));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(-2.75573141792967388112e-7));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(2.48015872888517045348e-5));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(-1.38888888888730564116e-3));
+	pc = _mm256_add_pd(_mm256_mul_pd(pc, z), _mm256_set1_pd(4.16666666666665929218e-2));
+	__m256d cosr = _mm256_sub_pd(_mm256_set1_pd(1.0),
+			_mm256_mul_pd(_mm256_set1_pd(0.5), z));
+	cosr = _mm256_add_pd(cosr, _mm256_mul_pd(_mm256_mul_pd(z, z), pc));
+
+	// cos(x) = cos(r), -sin(r), -cos(r), sin(r) for n mod 4 = 0, 1, 2, 3
+	__m256i q = _mm256_cvtepi32_epi64(_mm256_cvtpd_epi32(n));
+	__m256i odd = _mm256_and_si256(q, _mm256_set1_epi64x(1));
+	__m256d swap = _mm256_castsi256_pd(_mm256_cmpeq_epi64(odd,
+			_mm256_set1_epi64x(1)));
+	__m256d sign = _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_and_si256(
+			_mm256_add_epi64(q, _mm256_set1_epi64x(1)),
+			_mm256_set1_epi64x(2)), 62));
+
+	return _mm256_xor_pd(_mm256_blendv_pd(cosr, sinr, swap), sign);
+}
+#else
+const unsigned jakes_simd_width = 1;
+#endif
 
-  void operator() (pack_struct& ps);
-  // recalculates interference at 'ps'
-  
-  double get_interf() const {return interf;}
-};
+////////////////////////////////////////////////////////////////////////////////
+// jakes_amplitude                                                            //
+//                                                                            //
+// returns fading amplitude given the weighted sums of the oscillators        //
+////////////////////////////////////////////////////////////////////////////////
+static inline double jakes_amplitude(double sumx, double sumy, double cosalpha,
+		double sinalpha, double cosdt, unsigned n_osc) {
+	complex<double> x(2*sumx + M_SQRT2*cosalpha*cosdt,
+			2*sumy + M_SQRT2*sinalpha*cosdt);
+	x *= 1.0 / sqrt(n_osc + .5);
 
-/////////////////////////////////////
-// recalc_interference::operator() //
-/////////////////////////////////////
-void recalc_interference::operator() (pack_struct& ps) {
-  MPDU interf_pack = ps.pck;
-  if (pack.get_target() == interf_pack.get_target()) {
-    interf = HUGE_VAL;
-  } else {
-    double pl = path_loss[term_pair((interf_pack.get_source())->get_phy(),
-                          (pack.get_target())->get_phy())];
-    interf += pow(10.0,(interf_pack.get_power() - pl)/10.0);
-  }
+	return abs(x);
+}
 
-  if (pack.get_source() == interf_pack.get_target()) {
-    ps.interf_max = ps.interf = HUGE_VAL;
-  } else {
-    double pl = path_loss[term_pair((pack.get_source())->get_phy(),
-                          (interf_pack.get_target())->get_phy())];
-    ps.interf += pow(10.0,(pack.get_power() - pl)/10.0);
-    if (ps.interf > ps.interf_max) {
-      ps.interf_max = ps.interf;
-    }
-  }
-};
-
-/*
- * Jakes class
- *
- * Performs Jakes' method
- */
-Jakes::Jakes() {
-	doppler_spread = 0.0;
-	cosbeta.resize(1,0.0);
-	sinbeta.resize(1,0.0);
-	omega.resize(1,0.0);
-	theta.resize(1,0.0);
-	cosalpha = 0.0;
-	sinalpha = 0.0;
-	n_osc = 0;
-	xabs = 0.0;
-};
-Jakes::Jakes(double fd, unsigned no, random* r) {
+Jakes::Jakes(double fd, unsigned no, unsigned nt, random* r) {
 
 	n_osc = no;
+	n_taps = nt;
+	n_pad = (n_osc + jakes_simd_width - 1) / jakes_simd_width * jakes_simd_width;
 
 	doppler_spread = 2*M_PI*fd;
 
-	theta.resize(n_osc);
-
-	valarray<double> beta(M_PI/n_osc,n_osc);
+	// oscillators beyond 'n_osc' have zero gain
+	cosbeta.assign(n_pad, 0.0);
+	sinbeta.assign(n_pad, 0.0);
+	omega.assign(n_pad, 0.0);
 	for (unsigned index = 0; index < n_osc; ++index) {
-		beta[index] *= index+1.0;
-		theta[index] = r->uniform(0,2*M_PI);
+		double beta = M_PI/n_osc * (index+1.0);
+		omega[index] = doppler_spread
+				* cos(beta * double(n_osc) / double(2*n_osc+1));
+		cosbeta[index] = cos(beta);
+		sinbeta[index] = sin(beta);
 	}
-	double alpha = r->uniform(0,2*M_PI);
-
-	cosalpha = cos(alpha);
-	sinalpha = sin(alpha);
 
-	omega.resize(n_osc);
-	omega = doppler_spread * cos(beta * double(n_osc) / double(2*n_osc+1));
+	// random phases, drawn tap by tap
+	theta.assign(n_taps * n_pad, 0.0);
+	cosalpha.resize(n_taps);
+	sinalpha.resize(n_taps);
+	for (unsigned k = 0; k < n_taps; ++k) {
+		for (unsigned index = 0; index < n_osc; ++index) {
+			theta[k*n_pad + index] = r->uniform(0,2*M_PI);
+		}
+		double alpha = r->uniform(0,2*M_PI);
 
-	cosbeta.resize(n_osc);
-	sinbeta.resize(n_osc);
-	cosbeta = cos(beta);
-	sinbeta = sin(beta);
+		cosalpha[k] = cos(alpha);
+		sinalpha[k] = sin(alpha);
+	}
+};
 
-	// calculate fading
-	double t_aux = 0.0;
+unsigned long long Jakes::signature(unsigned long long h) const {
+	h = hash_bytes(&n_osc, sizeof(n_osc), h);
+	h = hash_bytes(&n_taps, sizeof(n_taps), h);
+	h = hash_bytes(&omega[0], n_osc * sizeof(double), h);
+	for (unsigned k = 0; k < n_taps; ++k)
+		h = hash_bytes(&theta[k*n_pad], n_osc * sizeof(double), h);
+	h = hash_bytes(&cosalpha[0], n_taps * sizeof(double), h);
+	return hash_bytes(&sinalpha[0], n_taps * sizeof(double), h);
+}
 
-	valarray<double> cosomegat = cos(omega*t_aux+theta);
-	valarray<double> aux1 = cosbeta * cosomegat;
-	valarray<double> aux2 = sinbeta * cosomegat;
-	complex<double> x(2*aux1.sum() + M_SQRT2*cosalpha*cos(doppler_spread*t_aux),
-			2*aux2.sum() + M_SQRT2*sinalpha*cos(doppler_spread*t_aux));
-	x *= 1.0 / sqrt(n_osc + .5);
+double Jakes::fade_scalar(unsigned k, double t) const {
 
-	xabs = abs(x);
+	const double* th = &theta[k*n_pad];
+	double sumx = 0.0;
+	double sumy = 0.0;
+	for (unsigned index = 0; index < n_osc; ++index) {
+		double cosomegat = cos(omega[index]*t + th[index]);
+		sumx += cosbeta[index] * cosomegat;
+		sumy += sinbeta[index] * cosomegat;
+	}
 
-};
+	return jakes_amplitude(sumx, sumy, cosalpha[k], sinalpha[k],
+			cos(doppler_spread*t), n_osc);
+}
 
-double Jakes::fade_calc(timestamp t) {
+void Jakes::fade_calc(timestamp t, valarray<double>& xabs) const {
 
-	  // calculate fading
-	  double t_aux = double(t);
+	// calculate fading
+	double t_aux = double(t);
+
+	xabs.resize(n_taps);
+
+#ifdef __AVX2__
+	double cosdt = cos(doppler_spread*t_aux);
+	__m256d tv = _mm256_set1_pd(t_aux);
+
+	for (unsigned k = 0; k < n_taps; ++k) {
+		const double* th = &theta[k*n_pad];
+		__m256d sumx = _mm256_setzero_pd();
+		__m256d sumy = _mm256_setzero_pd();
+		for (unsigned index = 0; index < n_pad; index += jakes_simd_width) {
+			__m256d cosomegat = cos4(_mm256_add_pd(
+					_mm256_mul_pd(_mm256_loadu_pd(&omega[index]), tv),
+					_mm256_loadu_pd(th + index)));
+			sumx = _mm256_add_pd(sumx,
+					_mm256_mul_pd(_mm256_loadu_pd(&cosbeta[index]), cosomegat));
+			sumy = _mm256_add_pd(sumy,
+					_mm256_mul_pd(_mm256_loadu_pd(&sinbeta[index]), cosomegat));
+		}
 
-	  valarray<double> cosomegat = cos(omega*t_aux+theta);
-	  valarray<double> aux1 = cosbeta * cosomegat;
-	  valarray<double> aux2 = sinbeta * cosomegat;
-	  complex<double> x(2*aux1.sum() + M_SQRT2*cosalpha*cos(doppler_spread*t_aux),
-	                    2*aux2.sum() + M_SQRT2*sinalpha*cos(doppler_spread*t_aux));
-	  x *= 1.0 / sqrt(n_osc + .5);
+		double sx[jakes_simd_width], sy[jakes_simd_width];
+		_mm256_storeu_pd(sx, sumx);
+		_mm256_storeu_pd(sy, sumy);
 
-	  xabs = abs(x);
+		xabs[k] = jakes_amplitude(sx[0] + sx[1] + sx[2] + sx[3],
+				sy[0] + sy[1] + sy[2] + sy[3], cosalpha[k], sinalpha[k], cosdt,
+				n_osc);
 
-	  return xabs;
+#ifdef _CHECK_FADING_
+		double ref = fade_scalar(k, t_aux);
+		if (fabs(xabs[k] - ref) > 1e-9 * (1.0 + ref))
+			throw my_exception(GENERAL,
+					"vectorized Jakes fading differs from scalar calculation");
+#endif
+	}
+#else
+	for (unsigned k = 0; k < n_taps; ++k) xabs[k] = fade_scalar(k, t_aux);
+#endif
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -259,6 +329,64 @@ ostream& operator << (ostream& os, const term_pair& t) {
 }
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// pack_struct constructor                                                    //
+////////////////////////////////////////////////////////////////////////////////
+pack_struct::pack_struct(MPDU p, unsigned nsub)
+: pck(p), interf(0.0, nsub), interf_max(0.0, nsub) {
+  source = ((p.get_source())->get_phy())->get_id();
+  target = ((p.get_target())->get_phy())->get_id();
+  power = pow(10.0, p.get_power()/10.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class waiting_list                                                         //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// waiting_list::push_back                                                    //
+////////////////////////////////////////////////////////////////////////////////
+void waiting_list::push_back(PHY* p) {
+  unsigned id = p->get_id();
+  if (id >= slot.size()) slot.resize(id + 1, -1);
+
+  if (slot[id] < 0) {
+    slot[id] = entry.size();
+    entry.push_back(p);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// waiting_list::remove                                                       //
+////////////////////////////////////////////////////////////////////////////////
+void waiting_list::remove(PHY* p) {
+  unsigned id = p->get_id();
+
+  if (id < slot.size() && slot[id] >= 0) {
+    entry[slot[id]] = 0;
+    slot[id] = -1;
+    ++n_removed;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// waiting_list::compact                                                      //
+////////////////////////////////////////////////////////////////////////////////
+void waiting_list::compact() {
+  if (!n_removed) return;
+
+  unsigned n = 0;
+  for (unsigned i = 0; i < entry.size(); ++i) {
+    if (entry[i]) {
+      slot[entry[i]->get_id()] = n;
+      entry[n++] = entry[i];
+    }
+  }
+  entry.resize(n);
+  n_removed = 0;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
 // class Channel                                                              //
@@ -267,10 +395,12 @@ ostream& operator << (ostream& os, const term_pair& t) {
 ////////////////////////////////////////////////////////////////////////////////
 // Channel constructor                                                        //
 ////////////////////////////////////////////////////////////////////////////////
-Channel::Channel(Scheduler *s, random *r, channel_struct p, log_file *l){
+Channel::Channel(Scheduler *s, random *r, SimContext* x, channel_struct p,
+                 log_file *l){
 
   ptr2sch = s;
   rand_gen = r;
+  ctx = x;
   
   mylog = l;
   logflag = (*mylog)(log_type::channel);
@@ -280,29 +410,48 @@ Channel::Channel(Scheduler *s, random *r, channel_struct p, log_file *l){
   DopplerSpread_Hz = p.doppler_spread;
   NumberSinus = p.number_sines;
   cModel = p.model;
+
+  // fading correlation is at least .9999 during the coherence time
+  double tc = bessel_j0_limit(.9999) / (2*M_PI*DopplerSpread_Hz);
+  if (DopplerSpread_Hz > 0 && tc < double(timestamp_max()))
+    CoherenceTime = timestamp(tc);
+  else CoherenceTime = timestamp_max();
+
+  // a margin is added so that rounding errors do not exclude PHYs at the edge
+  TxPowerMax_dBm = p.tx_power_max;
+  RangeLoss_dB = p.tx_power_max - p.cca_sens + 0.01;
+  CCASensitivity_dBm = p.cca_sens;
+  InterfFading = p.interf_fading;
+
+  n_phy = 0;
+  trace = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Channel_private::busy_channel_message                                      //
 //                                                                            //
-// tell all the terminals requesting notification that channel was occupied   //
-// by packet 'pck'                                                            //
+// tell all the terminals requesting notification and all BSSs with analytic  //
+// backoff that channel was occupied by packet 'ps'. Terminals out of range   //
+// of the source are skipped, as the packet cannot make the channel busy for  //
+// them.                                                                      //
 ////////////////////////////////////////////////////////////////////////////////
-void Channel_private::busy_channel_message(MPDU pck) {
+void Channel_private::busy_channel_message(const pack_struct& ps) {
 BEGIN_PROF("Channel::busy_channel_message")
 
-  list<PHY*>::iterator it = waiting_list_busy.begin();
-  
-  double power = pck.get_power();
-  PHY* source = (pck.get_source())->get_phy();
-
-  while (it != waiting_list_busy.end()) {
-    // iterator has to be stored in auxiliary variable 'it_aux' because it can
-    // be deleted by channel_is_busy()
-    list<PHY*>::iterator it_aux = it++;
+  waiting_list_busy.compact();
 
-    (*it_aux)->channel_occupied(get_interf_dBm(*it_aux));
+  // PHYs may be removed (or appended) by channel_occupied(), the size is
+  // therefore checked at every step and empty entries are skipped
+  for (size_t i = 0; i < waiting_list_busy.size(); ++i) {
+    PHY* p = waiting_list_busy[i];
+    if (p && in_range(ps, p->get_id()))
+      p->channel_occupied(get_interf_dBm(p));
+  }
 
+  for (vector<Contention*>::iterator ic = domains.begin();
+       ic != domains.end(); ++ic) {
+    PHY* m = (*ic)->get_medium();
+    if (in_range(ps, m->get_id())) (*ic)->channel_occupied(get_interf_dBm(m));
   }
 
 END_PROF("Channel::busy_channel_message")
@@ -312,18 +461,27 @@ END_PROF("Channel::busy_channel_message")
 ////////////////////////////////////////////////////////////////////////////////
 // Channel_private::free_channel_message                                      //
 //                                                                            //
-// tell all the terminals requesting notification that channel was released   //
-// by packet 'pck'                                                            //
+// tell all the terminals requesting notification and all BSSs with analytic  //
+// backoff that channel was released by packet 'ps'. Terminals out of range   //
+// of the source are skipped, as the channel was not busy for them because of //
+// this packet.                                                               //
 ////////////////////////////////////////////////////////////////////////////////
-void Channel_private::free_channel_message(MPDU pck) {
+void Channel_private::free_channel_message(const pack_struct& ps) {
 BEGIN_PROF("Channel::free_channel_message")
 
-  list<PHY*>::iterator it = waiting_list_free.begin();
-  while (it != waiting_list_free.end()) {
-    // iterator has to be stored in auxiliary variable because it can be
-    // deleted by channel_is_free()
-    list<PHY*>::iterator it_aux = it++;
-    (*it_aux)->channel_released(get_interf_dBm(*it_aux));
+  waiting_list_free.compact();
+
+  // PHYs may be removed (or appended) by channel_released()
+  for (size_t i = 0; i < waiting_list_free.size(); ++i) {
+    PHY* p = waiting_list_free[i];
+    if (p && in_range(ps, p->get_id()))
+      p->channel_released(get_interf_dBm(p));
+  }
+
+  for (vector<Contention*>::iterator ic = domains.begin();
+       ic != domains.end(); ++ic) {
+    PHY* m = (*ic)->get_medium();
+    if (in_range(ps, m->get_id())) (*ic)->channel_released(get_interf_dBm(m));
   }
 
 END_PROF("Channel::free_channel_message")
@@ -340,9 +498,8 @@ BEGIN_PROF("Channel::get_interf_dBm")
   double max_interf = -HUGE_VAL;
   for (list<pack_struct>::const_iterator it = air_pack.begin();
        it != air_pack.end(); ++it) {
-    double temp_interf = (it->pck).get_power()-
-                         path_loss[term_pair(((it->pck).get_source())->get_phy()
-                                             ,t)];
+    double temp_interf = (it->pck).get_power()
+                         - mean_loss(it->source, t->get_id());
     if (temp_interf >= max_interf) max_interf = temp_interf;
   }
 
@@ -356,7 +513,106 @@ BEGIN_PROF("Channel::get_interf_dBm")
 // returns path loss in dB between two given PHYs                             //
 ////////////////////////////////////////////////////////////////////////////////
 double Channel::get_path_loss (PHY *t1, PHY *t2) {
-  return path_loss[term_pair(t1,t2)];
+  return mean_loss(t1->get_id(), t2->get_id());
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Channel_private::find_link                                                 //
+//                                                                            //
+// returns pointer to the time-variant link between two PHYs, 0 if the PHYs   //
+// are not linked                                                             //
+////////////////////////////////////////////////////////////////////////////////
+Link* Channel_private::find_link(unsigned i, unsigned j) {
+BEGIN_PROF("Channel::find_link")
+
+  int k = link_index[i * n_phy + j];
+
+END_PROF("Channel::find_link")
+  return (k >= 0)? &links[k] : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Channel_private::add_interf                                                //
+//                                                                            //
+// the transmit power is divided equally among the subcarriers                //
+////////////////////////////////////////////////////////////////////////////////
+void Channel_private::add_interf(valarray<double>& acc, const pack_struct& ps,
+                                 unsigned target) {
+  unsigned n = acc.size();
+  double* a = &acc[0];
+
+  Link* l = find_link(ps.source, target);
+  if (l) {
+    const double* g = &(l->fade_gain(ptr2sch->now()))[0];
+    double c = ps.power / n;
+    for (unsigned k = 0; k < n; k++) a[k] += c * g[k];
+  } else {
+    double c = ps.power * mean_gain(ps.source, target) / n;
+    for (unsigned k = 0; k < n; k++) a[k] += c;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Channel_private::add_interference                                          //
+//                                                                            //
+// updates the interference sums of all packets on the air when a new packet  //
+// is added to the channel, and calculates the interference at new packet.    //
+// Interference is infinite if a terminal transmits and receives at the same  //
+// time, or if two packets have the same target.                              //
+////////////////////////////////////////////////////////////////////////////////
+void Channel_private::add_interference(pack_struct& ps) {
+  bool collision = false;
+
+  for (list<pack_struct>::iterator it = air_pack.begin();
+       it != air_pack.end(); ++it) {
+
+    // interference caused by packet on the air to new packet
+    if (it->target == ps.target) collision = true;
+    else if (!collision) add_interf(ps.interf, *it, ps.target);
+
+    // interference caused by new packet to packet on the air
+    if (it->target == ps.source) {
+      it->interf = HUGE_VAL;
+      it->interf_max = HUGE_VAL;
+    } else if (it->interf[0] != HUGE_VAL) {
+      add_interf(it->interf, ps, it->target);
+      for (unsigned k = 0; k < it->interf.size(); k++)
+        if (it->interf[k] > it->interf_max[k])
+          it->interf_max[k] = it->interf[k];
+    }
+  }
+
+  if (collision) ps.interf = HUGE_VAL;
+  ps.interf_max = ps.interf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Channel_private::remove_interference                                       //
+//                                                                            //
+// updates the interference sums of all packets on the air after packet 'ps'  //
+// has left the channel. If the gain from the source of 'ps' to a target is   //
+// time-variant, the interference at this target is summed again over the     //
+// remaining packets, as the gain may have changed since 'ps' was added.      //
+////////////////////////////////////////////////////////////////////////////////
+void Channel_private::remove_interference(const pack_struct& ps) {
+  for (list<pack_struct>::iterator it = air_pack.begin();
+       it != air_pack.end(); ++it) {
+    if (it->interf[0] == HUGE_VAL) continue;
+
+    if (!find_link(ps.source, it->target)) {
+      it->interf -= ps.power * mean_gain(ps.source, it->target)
+                    / it->interf.size();
+      continue;
+    }
+
+    it->interf = 0.0;
+    for (list<pack_struct>::const_iterator it2 = air_pack.begin();
+         it2 != air_pack.end(); ++it2) {
+      if (it2 != it) add_interf(it->interf, *it2, it->target);
+    }
+    for (unsigned k = 0; k < it->interf.size(); k++)
+      if (it->interf[k] > it->interf_max[k]) it->interf_max[k] = it->interf[k];
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -368,6 +624,145 @@ channel_model Channel::get_channel_model() {
 	return cModel;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Channel::get_fade_hits, Channel::get_fade_updates                          //
+//                                                                            //
+// sum the statistics of the fading cache over all time-variant links         //
+////////////////////////////////////////////////////////////////////////////////
+unsigned long Channel::get_fade_hits() const {
+  unsigned long n = 0;
+  for (vector<Link>::const_iterator it = links.begin(); it != links.end(); ++it)
+    n += it->get_hits();
+  return n;
+}
+
+unsigned long Channel::get_fade_updates() const {
+  unsigned long n = 0;
+  for (vector<Link>::const_iterator it = links.begin(); it != links.end(); ++it)
+    n += it->get_updates();
+  return n;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// struct trace_header                                                        //
+//                                                                            //
+// header of a fading trace file. It is followed by the subcarrier losses in  //
+// dB of all links, as floats, stored link by link and sample by sample.      //
+////////////////////////////////////////////////////////////////////////////////
+struct trace_header {
+  char magic[8];          // file format identification
+  unsigned n_links;       // number of links
+  unsigned n_samp;        // number of samples per link
+  unsigned n_sub;         // number of subcarriers
+  unsigned reserved;
+  unsigned long long step; // time between samples in time units
+  unsigned long long key;  // hash of all parameters and links
+};
+
+const char trace_magic[8] = {'S','y','s','S','i','m','F','1'};
+
+////////////////////////////////////////////////////////////////////////////////
+// map_trace                                                                  //
+//                                                                            //
+// returns trace file 'name' mapped into memory if it exists and matches the  //
+// header 'hd' and length 'len', 0 otherwise                                  //
+////////////////////////////////////////////////////////////////////////////////
+static mapped_file* map_trace(const string& name, const trace_header& hd,
+                              size_t len) {
+  mapped_file* f;
+  try {
+    f = new mapped_file(name);
+  } catch (my_exception&) {
+    return 0;
+  }
+
+  if (f->size() == len && !memcmp(f->data(), &hd, sizeof(hd))) return f;
+
+  delete f;
+  return 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Channel::open_trace                                                        //
+//                                                                            //
+// the trace contains the subcarrier losses of all links at multiples of the  //
+// coherence time, until after 'duration'. The file name is composed of       //
+// 'prefix' and a hash of the fading parameters and random phases of all      //
+// links. The file is written to a temporary name first, so that parallel     //
+// iterations never map an incomplete trace.                                  //
+////////////////////////////////////////////////////////////////////////////////
+string Channel::open_trace(const string& prefix, timestamp duration) {
+  if (links.empty() || trace) return "";
+
+  if (CoherenceTime == timestamp(0u))
+    throw my_exception(GENERAL, "Coherence time too short for fading trace");
+
+  trace_header hd;
+  memset(&hd, 0, sizeof(hd));
+  memcpy(hd.magic, trace_magic, sizeof(hd.magic));
+  hd.n_links = links.size();
+  hd.n_samp = (CoherenceTime == timestamp_max())? 1
+              : unsigned(duration / CoherenceTime) + 2;
+  hd.n_sub = ctx->standard.get_numSubcarriers();
+  hd.step = CoherenceTime / timestamp(1u);
+
+  unsigned long long key = hash_bytes(&hd, sizeof(hd));
+  for (vector<Link>::const_iterator it = links.begin(); it != links.end(); ++it)
+    key = it->trace_key(key);
+  hd.key = key;
+
+  ostringstream ss;
+  ss << prefix << hex << setfill('0') << setw(16) << key << ".trc";
+  string name = ss.str();
+
+  size_t len = sizeof(hd)
+               + size_t(hd.n_links) * hd.n_samp * hd.n_sub * sizeof(float);
+
+  trace = map_trace(name, hd, len);
+
+  if (!trace) {
+    ostringstream tmp;
+    tmp << name << '.' << this << ".tmp";
+
+    ofstream os(tmp.str().c_str(), ios::out | ios::binary);
+    if (!os.is_open()) throw my_exception(OPENFILE, tmp.str());
+
+    os.write((const char*) &hd, sizeof(hd));
+    for (vector<Link>::iterator it = links.begin(); it != links.end(); ++it)
+      it->write_trace(os, hd.n_samp);
+    os.close();
+    if (os.fail())
+      throw my_exception(GENERAL, tmp.str() + " could not be written!");
+
+    // another iteration may have created the same trace in the meantime
+    if (rename(tmp.str().c_str(), name.c_str())) {
+      trace = map_trace(name, hd, len);
+      if (!trace) {
+        remove(name.c_str());
+        if (rename(tmp.str().c_str(), name.c_str()))
+          throw my_exception(OPENFILE, name);
+      } else remove(tmp.str().c_str());
+    }
+
+    if (logflag) *mylog << "Channel: fading trace " << name << " created"
+                        << endl;
+  }
+
+  if (!trace) trace = map_trace(name, hd, len);
+  if (!trace) throw my_exception(OPENFILE, name);
+
+  const float* p = (const float*)(trace->data() + sizeof(hd));
+  for (vector<Link>::iterator it = links.begin(); it != links.end(); ++it) {
+    it->set_trace(p, hd.n_samp);
+    p += size_t(hd.n_samp) * hd.n_sub;
+  }
+
+  if (logflag) *mylog << "Channel: fading of " << links.size()
+                      << " links played from trace " << name << endl;
+
+  return name;
+}
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // Channel::new_link                                                          //
@@ -385,18 +780,35 @@ void Channel::new_link(PHY* pt1, PHY* pt2) {
   }
 
   // create link if it doesn't exist yet
-  term_pair tp(pt1,pt2);
+  unsigned id1 = pt1->get_id();
+  unsigned id2 = pt2->get_id();
+  if (link_index[id1 * n_phy + id2] >= 0) return;
 
-  for(vector<Link>::const_iterator it = links.begin(); it != links.end(); ++it){
-    if (it->belong(tp)) return;
-  }
-  
-  Link newlink(tp, path_loss[tp], DopplerSpread_Hz, rand_gen, NumberSinus, cModel);
+  add_link(pt1, pt2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Channel_private::add_link                                                  //
+//                                                                            //
+// the same link is employed in both directions. Pointers to other links may  //
+// become invalid.                                                            //
+////////////////////////////////////////////////////////////////////////////////
+Link* Channel_private::add_link(PHY* pt1, PHY* pt2) {
+  unsigned id1 = pt1->get_id();
+  unsigned id2 = pt2->get_id();
+
+  term_pair tp(pt1,pt2);
+  double pl = mean_loss(id1, id2);
+  Link newlink(tp, pl, DopplerSpread_Hz, rand_gen, ctx, NumberSinus,
+               cModel, CoherenceTime);
+  link_index[id1 * n_phy + id2] = link_index[id2 * n_phy + id1] = links.size();
   links.push_back(newlink);
 
   if (logflag) *mylog << "Channel: New time-variant link created between "
                       << *pt1 << " and " << *pt2 << ", path_loss = " 
-                      << path_loss[tp] << "dB" << endl;
+                      << pl << "dB" << endl;
+
+  return &links.back();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -409,17 +821,46 @@ void Channel_private::new_term(PHY* t) {
   if (logflag) *mylog << "Channel: " << *t << " added to channel" << endl;
 
   Position pos = t->get_pos();
+  unsigned id = t->get_id();
+
+  // enlarge path loss matrices, if necessary
+  if (id >= n_phy) {
+    unsigned n = id + 1;
+    vector<double> new_loss(n * n, 0.0);
+    vector<double> new_gain(n * n, 1.0);
+    vector<int> new_index(n * n, -1);
+    neighbours.resize(n);
+    for (unsigned i = 0; i < n_phy; ++i) {
+      for (unsigned j = 0; j < n_phy; ++j) {
+        new_loss[i * n + j] = loss_dB[i * n_phy + j];
+        new_gain[i * n + j] = gain_lin[i * n_phy + j];
+        new_index[i * n + j] = link_index[i * n_phy + j];
+      }
+    }
+    loss_dB.swap(new_loss);
+    gain_lin.swap(new_gain);
+    link_index.swap(new_index);
+    n_phy = n;
+  }
 
   for(vector<PHY*>::const_iterator it = term_list.begin();
       it != term_list.end(); ++it) {
     double distance = pos.distance((*it)->get_pos());
     double pl = RefLoss_dB + 10.0*LossExponent*log10(distance);
-    path_loss[term_pair(*it,t)] = pl;
+    unsigned id2 = (*it)->get_id();
+    loss_dB[id * n_phy + id2] = loss_dB[id2 * n_phy + id] = pl;
+    gain_lin[id * n_phy + id2] = gain_lin[id2 * n_phy + id] = pow(10.0,-pl/10.0);
+
+    if (pl <= RangeLoss_dB) {
+      neighbours[id2].push_back(t);
+      neighbours[id].push_back(*it);
+    }
 
     if (logflag) *mylog << "\tpath loss between " << *t << " and " << **it 
                         << " is " << pl << "dB" << endl;
   }
 
+  neighbours[id].push_back(t);
   term_list.push_back(t);
 }
 
@@ -434,19 +875,14 @@ void Channel::send_packet_all(MPDU pack) {
 BEGIN_PROF("Channel::send_packet_all")
 
   // check for existing packets and calculate interference
-  if (air_pack.size()) {
-    recalc_interference interf(path_loss, pack);
-    interf = for_each(air_pack.begin(), air_pack.end(), interf);
-
-    air_pack.push_back(pack_struct(pack,interf.get_interf()));
-  } else {
-    air_pack.push_back(pack_struct(pack));
-  }
+  pack_struct ps(pack, ctx->standard.get_numSubcarriers());
+  add_interference(ps);
+  air_pack.push_back(ps);
 
   // schedule transmission end
-  ptr2sch->schedule(Event(ptr2sch->now() + pack.get_duration(),
-                    (void*)&wrapper_to_stop_send_all,
-                    (void*)this, pack.get_id()));
+  ptr2sch->schedule(Event::callback<Channel_private,
+      &Channel::stop_send_all>(ptr2sch->now() + pack.get_duration(),
+                                      this, pack.get_id()));
 
   // update channel gain
   /*if (DopplerSpread_Hz > 0) {
@@ -456,7 +892,7 @@ BEGIN_PROF("Channel::send_packet_all")
     path_loss[tp] = itl->fade(ptr2sch->now());
   }*/
 
-  busy_channel_message (pack);
+  busy_channel_message (ps);
 END_PROF("Channel::send_packet_all")
 
 }
@@ -470,20 +906,15 @@ void Channel::send_packet_one(MPDU pack) {
 
 BEGIN_PROF("Channel::send_packet_one")
 
-  if (air_pack.size()) {
-    // check for existing packets and calculate interference
-    recalc_interference interf(path_loss, pack);
-    interf = for_each(air_pack.begin(), air_pack.end(), interf);
-
-    air_pack.push_back(pack_struct(pack,interf.get_interf()));
-  } else {
-    air_pack.push_back(pack_struct(pack));
-  }
+  // check for existing packets and calculate interference
+  pack_struct ps(pack, ctx->standard.get_numSubcarriers());
+  add_interference(ps);
+  air_pack.push_back(ps);
 
   // schedule transmission end
-  ptr2sch->schedule(Event(ptr2sch->now() + pack.get_duration(),
-                    (void*)&wrapper_to_stop_send_one,
-                    (void*)this, pack.get_id()));
+  ptr2sch->schedule(Event::callback<Channel_private,
+      &Channel::stop_send_one>(ptr2sch->now() + pack.get_duration(),
+                                      this, pack.get_id()));
 
     /*if (DopplerSpread_Hz > 0) {
       term_pair tp((pack.get_source())->get_phy()
@@ -493,7 +924,7 @@ BEGIN_PROF("Channel::send_packet_one")
       path_loss[tp] = itl->fade(ptr2sch->now());
     }*/
 
-  busy_channel_message (pack);
+  busy_channel_message (ps);
 
 END_PROF("Channel::send_packet_one")
 
@@ -514,43 +945,51 @@ BEGIN_PROF("Channel::stop_send_all")
     throw(GENERAL,"Packet not found in Channel::stop_send_all");
 
   MPDU pack = it->pck;
+  pack_struct ps(std::move(*it)); // 'it' is erased below
 
   PHY* source = (pack.get_source())->get_phy();
   PHY* target = (pack.get_target())->get_phy();
 
-  term_pair tp(source,target);
   valarray<double> pLoss;
   timestamp t = ptr2sch->now() - pack.get_duration();
 
-  for(vector<Link>::iterator it = links.begin(); it != links.end(); ++it){
-    if(it->belong(tp)) pLoss = (it->fade(t));
-  }
+  Link* l = find_link(ps.source, ps.target);
+  if (l) pLoss = l->fade(t);
+
   // send to target terminal
-  target->receive(pack, pLoss,it->interf_max);
+  target->receive(pack, pLoss, ps.interf_max);
 
   air_pack.erase(it);
 
 
-  // send to all other terminals
-  for (vector<PHY*>::iterator term_it = term_list.begin();
-       term_it != term_list.end(); ++term_it) {
+  // send to all other terminals in range
+  const vector<PHY*>& rx_list = ((pack.get_power() > TxPowerMax_dBm)?
+                                 term_list : neighbours[ps.source]);
+  for (vector<PHY*>::const_iterator term_it = rx_list.begin();
+       term_it != rx_list.end(); ++term_it) {
     if (*term_it != target && *term_it != source) {
-
-      valarray<double> pLoss(path_loss[term_pair(source,*term_it)],Standard::get_numSubcarriers());
-      (*term_it)->receive(pack, pLoss);
+      unsigned id = (*term_it)->get_id();
+      double pl = mean_loss(ps.source, id);
+
+      // fading is only relevant if packet may reach carrier sensitivity
+      Link* li = 0;
+      if (InterfFading && pack.get_power() - pl >= CCASensitivity_dBm) {
+        li = find_link(ps.source, id);
+        if (!li) li = add_link(source, *term_it);
+      }
+
+      if (li) (*term_it)->receive(pack, li->fade(t));
+      else {
+        valarray<double> pLoss(pl, ctx->standard.get_numSubcarriers());
+        (*term_it)->receive(pack, pLoss);
+      }
     }
   }
 
-  free_channel_message(pack);
+  free_channel_message(ps);
 
   // recalculate interference at active packets
-  double power_dB = pack.get_power();
-  for (it = air_pack.begin(); it != air_pack.end(); ++it) {
-    it->interf -= pow(10.0,
-                      (power_dB
-                       - path_loss[term_pair(source,
-                                 ((it->pck).get_target())->get_phy())]) / 10.0);
-  }
+  remove_interference(ps);
 END_PROF("Channel::stop_send_all")
 
 }
@@ -571,32 +1010,24 @@ BEGIN_PROF("Channel::stop_send_one")
     throw(GENERAL,"Packet not found in Channel::stop_send_all");
 
   MPDU pack = it->pck;
+  pack_struct ps(std::move(*it)); // 'it' is erased below
 
   PHY* source = (pack.get_source())->get_phy();
   PHY* target = (pack.get_target())->get_phy();
 
-  term_pair tp(source,target);
   valarray<double> pLoss;
   timestamp t = ptr2sch->now() - pack.get_duration();
 
-  for(vector<Link>::iterator it = links.begin(); it != links.end(); ++it){
-    if(it->belong(tp)) pLoss = it->fade(t);
-  }
+  Link* l = find_link(ps.source, ps.target);
+  if (l) pLoss = l->fade(t);
 
-  target->receive(pack, pLoss,it->interf_max);
+  target->receive(pack, pLoss, ps.interf_max);
 
   air_pack.erase(it);
-  free_channel_message(pack);
+  free_channel_message(ps);
 
   // recalculate interference at active packets
-  double power_dB = pack.get_power();
-  for (it = air_pack.begin(); it != air_pack.end(); ++it) {
-    it->interf -= pow(10.0
-                      ,(power_dB
-                       - path_loss[term_pair((pack.get_source())->get_phy()
-                                              ,(pack.get_target())->get_phy())])
-                       / 10.0);
-  }
+  remove_interference(ps);
 END_PROF("Channel::stop_send_one")
 
 }
@@ -611,12 +1042,15 @@ END_PROF("Channel::stop_send_one")
 ////////////////////////////////////////////////////////////////////////////////
 // Link constructor                                                           //
 ////////////////////////////////////////////////////////////////////////////////
-Link::Link(term_pair t, double pl, double fd, random* r, unsigned ns, channel_model cm)
-: terms(t), path_loss_mean(pl) {
+Link::Link(term_pair t, double pl, double fd, random* r, SimContext* x,
+           unsigned ns, channel_model cm, timestamp tc)
+: terms(t), ctx(x), path_loss_mean(pl), coherence(tc) {
 
-	time_last = timestamp(0);
-	time_diff_min = -1;
-	doppler_spread = 2*M_PI*fd;
+	next_update = coherence;
+	n_hits = n_updates = 0;
+	trace = 0;
+	trace_len = 0;
+	gain_valid = false;
 
 	switch(cm) {
 	case A:
@@ -652,16 +1086,15 @@ Link::Link(term_pair t, double pl, double fd, random* r, unsigned ns, channel_mo
 	}
 
 	taps_amps_fade.resize(nTaps,0.0);
+	interp = &(ctx->get_interp_table(cm, taps_delays));
 
 	// Apply fading to all taps
-	taps_jks.clear();
-	for(unsigned k = 0; k < nTaps; ++k){
-		Jakes auxJks = Jakes(fd,ns,r);
-		taps_amps_fade[k] = sqrt(taps_amps[k])*auxJks.fade_calc(timestamp(0));
-		taps_jks.push_back(auxJks);
-	}
+	taps_jks = Jakes(fd,ns,nTaps,r);
+	taps_jks.fade_calc(timestamp(0), taps_amps_fade);
+	taps_amps_fade *= sqrt(taps_amps);
 
 	// Resample
+	init_resample();
 	resample();
 
 	/*cout << "Taps amps: 		";
@@ -692,30 +1125,34 @@ Link::Link(term_pair t, double pl, double fd, random* r, unsigned ns, channel_mo
 // updates channel fading,                                                    //
 // and returns the link gain amplitude at time 't' in dB                      //
 ////////////////////////////////////////////////////////////////////////////////
-valarray<double> Link::fade(timestamp t) {
+const valarray<double>& Link::fade(timestamp t) {
 BEGIN_PROF("Link::fade")
 
-  double time_diff_new = double(t - time_last);
-
-  if (time_diff_new <= time_diff_min) {
-	  return path_loss;
+  // if correlation is too large, channel does not change
+  if (t <= next_update) {
+	++n_hits;
+	END_PROF("Link::fade")
+	return path_loss;
   }
+  ++n_updates;
+  next_update = (coherence < timestamp_max() - t)? t + coherence
+		                                         : timestamp_max();
 
-			  // if correlation is too large, channel does not change
-  if (bessel_j0(doppler_spread * time_diff_new) >= .9999) {
-	time_diff_min = time_diff_new;
+  if (trace) {
+	play_trace(t);
+	END_PROF("Link::fade")
 	return path_loss;
   }
 
   // Aplly fading to all taps
-  for(unsigned k = 0; k < nTaps; ++k){
-	  taps_amps_fade[k] = sqrt(taps_amps[k])*taps_jks[k].fade_calc(timestamp(t));
-  }
+  taps_jks.fade_calc(t, taps_amps_fade);
+  taps_amps_fade *= sqrt(taps_amps);
 
   //Resample
   resample();
 
   path_loss = carrier_loss + path_loss_mean;
+  gain_valid = false;
 
 
 #ifdef _SAVE_RATE_ADAPT
@@ -731,69 +1168,159 @@ END_PROF("Link::fade")
   return path_loss;
 }
 
-void Link::resample() {
+////////////////////////////////////////////////////////////////////////////////
+// Link::fade_gain                                                            //
+//                                                                            //
+// gains are only converted from dB when requested after an update            //
+////////////////////////////////////////////////////////////////////////////////
+const valarray<double>& Link::fade_gain(timestamp t) {
+  fade(t);
+
+  if (!gain_valid) {
+	gain.resize(path_loss.size());
+	for (unsigned k = 0; k < path_loss.size(); k++)
+		gain[k] = pow(10.0, -path_loss[k]/10.0);
+	gain_valid = true;
+  }
+  return gain;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Link::trace_key                                                            //
+//                                                                            //
+// the fading of a link is determined by its oscillators and random phases,   //
+// by the power and delay profile and by the subcarriers of the standard      //
+////////////////////////////////////////////////////////////////////////////////
+unsigned long long Link::trace_key(unsigned long long h) const {
+	h = taps_jks.signature(h);
+	h = hash_bytes(&taps_amps[0], nTaps * sizeof(double), h);
+	h = hash_bytes(&taps_delays[0], nTaps * sizeof(double), h);
+
+	double W = ctx->standard.get_band_double();
+	double rollof = ctx->standard.get_rollof();
+	unsigned NFFT = fft->size();
+	h = hash_bytes(&W, sizeof(W), h);
+	h = hash_bytes(&rollof, sizeof(rollof), h);
+	h = hash_bytes(&NFFT, sizeof(NFFT), h);
+	return hash_bytes(&carrier_index[0], carrier_index.size() * sizeof(unsigned),
+	                  h);
+}
 
-	double W = Standard::get_band_double();
-	double sample_time = 1/W;
-	unsigned max_samp = (unsigned)ceil(taps_delays[nTaps - 1]/sample_time);
-	valarray<double> samples;
+////////////////////////////////////////////////////////////////////////////////
+// Link::write_trace                                                          //
+////////////////////////////////////////////////////////////////////////////////
+void Link::write_trace(ostream& os, unsigned n) {
+	vector<float> buf(carrier_loss.size());
 
-	unsigned NFFT = (unsigned)pow(2.0, ceil(log((double)max_samp)/log(2.0)));
-	if(NFFT < Standard::get_lengthFFT()) NFFT = Standard::get_lengthFFT();
-
-	//cout << "NFFT: " << NFFT << endl;
-
-	samples.resize((2*NFFT+1),0.0);
-	double time = 0.0;
-	for(unsigned k = 0; k <= max_samp; ++k) {
-		time = k*sample_time;
-		double time_diff;
-		for(unsigned j = 0; j < nTaps; j++){
-			time_diff = time - taps_delays[j];
-			samples[2*k + 1] += taps_amps_fade[j]*invraisedcos(time_diff,W,Standard::get_rollof());
-		}
+	for (unsigned k = 0; k < n; k++) {
+		taps_jks.fade_calc(timestamp(long_integer(k)) * coherence, taps_amps_fade);
+		taps_amps_fade *= sqrt(taps_amps);
+		resample();
 
+		for (unsigned i = 0; i < buf.size(); i++) buf[i] = float(carrier_loss[i]);
+		os.write((const char*) &buf[0], buf.size() * sizeof(float));
 	}
+}
 
-	samples = four1(samples,NFFT,1); //Calculate the FFT
+////////////////////////////////////////////////////////////////////////////////
+// Link::set_trace                                                            //
+////////////////////////////////////////////////////////////////////////////////
+void Link::set_trace(const float* p, unsigned n) {
+	trace = p;
+	trace_len = n;
+	play_trace(timestamp(0));
+}
 
-	// Calculate abslute value of FFT
-	valarray<double> samplesFFT;
-	samplesFFT.resize(NFFT,0.0);
-	for(unsigned k = 0; k < NFFT; k++) {
-		samplesFFT[k] = myabs(samples[2*k+1],samples[2*k+2]);
+////////////////////////////////////////////////////////////////////////////////
+// Link::play_trace                                                           //
+//                                                                            //
+// subcarrier losses are interpolated linearly between the samples before and //
+// after 't'. The last sample is held after the end of the trace.             //
+////////////////////////////////////////////////////////////////////////////////
+void Link::play_trace(timestamp t) {
+	unsigned nSub = carrier_loss.size();
+
+	long_integer k = (trace_len > 1)? t / coherence : 0;
+	double frac = 0;
+	if (k + 1 < trace_len)
+		frac = double(t - timestamp(k) * coherence) / double(coherence);
+	else k = trace_len - 1;
+
+	gain_valid = false;
+
+	const float* a = trace + k * nSub;
+	if (frac > 0) {
+		const float* b = a + nSub;
+		for (unsigned i = 0; i < nSub; i++)
+			path_loss[i] = path_loss_mean + a[i] + frac * (b[i] - a[i]);
+	} else {
+		for (unsigned i = 0; i < nSub; i++)
+			path_loss[i] = path_loss_mean + a[i];
 	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Link::init_resample                                                        //
+//                                                                            //
+// selects FFT length and the FFT coefficient of each subcarrier, and         //
+// allocates the buffers employed by 'resample'                               //
+////////////////////////////////////////////////////////////////////////////////
+void Link::init_resample() {
+
+	max_samp = interp->max_samp();
+
+	unsigned NFFT = (unsigned)pow(2.0, ceil(log((double)max_samp)/log(2.0)));
+	if(NFFT < ctx->standard.get_lengthFFT()) NFFT = ctx->standard.get_lengthFFT();
+	if(NFFT <= max_samp) NFFT *= 2;
+
+	fft = &(ctx->get_fft_plan(NFFT));
+	samples.assign(NFFT, 0.0);
+	spectrum.assign(NFFT, 0.0);
 
 	// Take loss only at carriers indexes
-	unsigned len = Standard::get_lengthFFT();
+	unsigned len = ctx->standard.get_lengthFFT();
 	unsigned skp = NFFT/len;
-	unsigned nSub = Standard::get_numSubcarriers();
-
-	valarray<double> auxVal;
-	auxVal.resize(len,0.0);
-	if(skp == 1) {
-		auxVal = samplesFFT;
-	}else {
-		unsigned j = 0;
-		for(unsigned k = 0; k < len; k++){
-			auxVal[k] = samplesFFT[j];
-			j += skp;
-			if(j == NFFT/2) j+= (skp - 1);
-		}
+	unsigned nSub = ctx->standard.get_numSubcarriers();
+
+	vector<unsigned> auxIdx(len);
+	unsigned j = 0;
+	for(unsigned k = 0; k < len; k++){
+		auxIdx[k] = j;
+		j += skp;
+		if(skp > 1 && j == NFFT/2) j+= (skp - 1);
 	}
 
 	// Ignore silent carriers
-	carrier_loss.resize(nSub,0.0);
+	carrier_index.resize(nSub);
 	unsigned last_not_silent = 0;
 	for(unsigned k = 0; k < nSub; k++) {
-		while(Standard::is_silent(last_not_silent)){
+		while(ctx->standard.is_silent(last_not_silent)){
 			last_not_silent++;
 		};
-		carrier_loss[k] = auxVal[last_not_silent];
+		carrier_index[k] = auxIdx[last_not_silent];
 		last_not_silent++;
 	}
 
-	carrier_loss = to_dB(carrier_loss);
+	carrier_loss.resize(nSub,0.0);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Link::resample                                                             //
+//                                                                            //
+// calculates subcarrier losses in dB from the faded tap amplitudes, without  //
+// allocating memory. Tap amplitudes are interpolated at the sampling         //
+// instants with the precomputed table of the channel model.                  //
+////////////////////////////////////////////////////////////////////////////////
+void Link::resample() {
+
+	interp->interpolate(taps_amps_fade, &samples[0]); // time-domain samples
+
+	fft->transform(&samples[0], &spectrum[0]); //Calculate the FFT
+
+	// loss at subcarriers
+	for(unsigned k = 0; k < carrier_index.size(); k++) {
+		carrier_loss[k] = 10*log10(fft->abs(&spectrum[0], carrier_index[k]));
+	}
 
 }
 
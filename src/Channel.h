@@ -38,10 +38,15 @@ struct channel_struct {
   double doppler_spread; // maximum Doppler spread in Hz
   unsigned number_sines; // number of sinewaves for Jakes' model
   channel_model model;	 // channel propagation model
+  double tx_power_max;   // maximum transmit power of all terminals in dBm
+  double cca_sens;       // carrier sensitivity level of all terminals in dBm
+  bool interf_fading;    // if true, interference links are also time-variant
 
-  channel_struct(double le, double rl, double ds, unsigned ns, channel_model cmod)
+  channel_struct(double le, double rl, double ds, unsigned ns, channel_model cmod,
+                 double pmax, double sens, bool inf)
             : loss_exponent(le), ref_loss(rl), doppler_spread(ds),
-              number_sines(ns), model(cmod) {}
+              number_sines(ns), model(cmod), tx_power_max(pmax),
+              cca_sens(sens), interf_fading(inf) {}
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -81,10 +86,30 @@ struct channel_struct {
 //    The channel keeps lists of all the PHYs requiring notification. By      //
 //    calling 'busy_channel_remove' or 'free_channel_remove' the PHY can be   //
 //    removed from these lists.                                               //
+//    A BSS with analytic backoff is registered once with                     //
+//    'contention_request' and notified of all changes, with the interference //
+//    level at its access point (see "Contention.h").                         //
+//                                                                            //
+//  - After all links have been created, 'open_trace' may be called so that   //
+//    the fading of all links is read from a memory-mapped trace file. The    //
+//    file name is derived from the parameters and random phases of all       //
+//    links. If no such file exists, the fading is synthesized once and the   //
+//    file is written, so that later iterations with the same seed and        //
+//    channel parameters, e.g. in a sweep over traffic or MAC parameters,     //
+//    skip the fading calculation.                                            //
 //                                                                            //
 //  Remarks:                                                                  //
-//  . non-active links are static, active links have Rayleigh fading          //
+//  . non-active links are static, active links have Rayleigh fading. If      //
+//    'interf_fading' is set, a time-variant link is also created between a   //
+//    source and a bystander when a packet first reaches the bystander above  //
+//    the carrier sensitivity level, considering the mean path loss. Such a   //
+//    link is used in both directions, and it is not part of a fading trace   //
+//    opened before its creation.                                             //
 //  . interference is modelled as highest interference during a packet        //
+//  . packets are only delivered to, and channel occupation is only notified  //
+//    to, PHYs in range of the source, i.e., PHYs at which a packet sent with //
+//    maximum power is received above the carrier sensitivity level. Packets  //
+//    sent with a higher power reach all PHYs.                                //
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 class Channel : Channel_private {
@@ -92,10 +117,11 @@ class Channel : Channel_private {
 public:
   Channel(Scheduler *s,  // pointer to simulation scheduler
           random *r,
+          SimContext* x, // pointer to simulation context
           channel_struct p,
           log_file* l
           );
-  ~Channel() {};
+  ~Channel() {delete trace;}
 
   void new_link(PHY* pt1, PHY* pt2);
   // creates an active time-variant channel link between two terminals
@@ -111,6 +137,9 @@ public:
   void free_channel_remove(PHY* p) {waiting_list_free.remove(p);}
   // PHY '*p' cancels notification request
 
+  void contention_request(Contention* c) {domains.push_back(c);}
+  // BSS '*c' is notified of every channel occupation and release
+
   void send_packet_one(MPDU pack);
   // send packet 'pack', it will be received just by target terminal
   void send_packet_all(MPDU pack);
@@ -124,5 +153,14 @@ public:
 
   channel_model get_channel_model();
 
+  string open_trace(const string& prefix, timestamp duration);
+  // all time-variant links play their fading from a trace file until
+  // 'duration', which is created if necessary. Returns the file name.
+
+  unsigned long get_fade_hits() const;
+  unsigned long get_fade_updates() const;
+  // return number of link gain requests served without and with an update of
+  // the fading of all time-variant links
+
 };
 #endif
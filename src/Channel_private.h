@@ -35,8 +35,12 @@
 #include "long_integer.h"
 #include "random.h"
 #include "log.h"
+#include "mymath.h"
+#include "mapped_file.h"
 
 class PHY;
+class SimContext;
+class Contention;
 
 typedef enum{
 	A,
@@ -74,35 +78,50 @@ public:
 /*
  * Jakes class
  *
- * Performs Jakes method
+ * Performs Jakes method for all taps of a link
  *
+ * Oscillator frequencies and gains are equal for all taps, only the random
+ * phases are stored for each tap. The arrays are padded with zero gains to a
+ * multiple of the SIMD width, so that the sum of oscillators is calculated
+ * with AVX2 instructions if the compiler targets AVX2 (__AVX2__ defined), and
+ * with scalar code otherwise.
+ * If _CHECK_FADING_ is defined, every vectorized calculation is compared to
+ * the scalar one.
  */
 class Jakes {
 
 	double doppler_spread;
-	valarray<double> cosbeta;
-	valarray<double> sinbeta;
-	valarray<double> omega;
-	valarray<double> theta;
-	double cosalpha;
-	double sinalpha;
-	unsigned n_osc;
-	double xabs;
+	unsigned n_osc;  // number of oscillators per tap
+	unsigned n_pad;  // n_osc rounded up to a multiple of the SIMD width
+	unsigned n_taps; // number of taps
+
+	// oscillator parameters, equal for all taps
+	vector<double> cosbeta;
+	vector<double> sinbeta;
+	vector<double> omega;
+
+	// random parameters of each tap, theta[k*n_pad+n] for tap k, oscillator n
+	vector<double> theta;
+	vector<double> cosalpha;
+	vector<double> sinalpha;
+
+	double fade_scalar(unsigned k, double t) const;
+	// returns fading amplitude of tap 'k' at time 't' calculated without SIMD
 
 public:
 
-	Jakes();
-	Jakes(double fd, unsigned no, random* r);
-	double fade_calc(timestamp t);
+	Jakes() : doppler_spread(0.0), n_osc(0), n_pad(0), n_taps(0) {}
+	Jakes(double fd, unsigned no, unsigned nt, random* r);
+
+	void fade_calc(timestamp t, valarray<double>& xabs) const;
+	// calculates fading amplitudes of all taps at time 't'
+
+	unsigned long long signature(unsigned long long h) const;
+	// returns hash of all oscillator parameters, continuing from hash 'h'
 
 	double get_doppler_spread() const {return doppler_spread;};
-	valarray<double> get_cosbeta() const {return cosbeta;};
-	valarray<double> get_sinbeta() const {return sinbeta;};
-	valarray<double> get_omega()   const {return omega;};
-	valarray<double> get_theta()   const {return theta;};
-	double get_cosalpha() const {return cosalpha;};
-	double get_sinalpha() const {return sinalpha;};
 	unsigned get_n_osc() const {return n_osc;};
+	unsigned get_n_taps() const {return n_taps;};
 
 };
 
@@ -131,11 +150,19 @@ public:
 //  - when constructor is called with parameters, channel link is initialized //
 //    with random values for theta_n and alpha. Each time the function 'fade' //
 //    is called the channel gain will be updated and the new value returned.  //
+//  - the channel gain is only updated if the latest update happened more     //
+//    than one coherence time before, i.e., if the fading correlation has     //
+//    dropped below 0.9999. Otherwise the stored value is returned.           //
+//  - instead of synthesizing the fading, a link may play a trace of its      //
+//    subcarrier losses at multiples of the coherence time, which is          //
+//    interpolated linearly (see 'set_trace' and Channel::open_trace).        //
 ////////////////////////////////////////////////////////////////////////////////
 class Link {
   term_pair terms; // linked terminals
 
-  vector<Jakes> taps_jks; // Jakes model class for path taps
+  SimContext* ctx; // pointer to simulation context
+
+  Jakes taps_jks; // Jakes model for all path taps
 
   unsigned nTaps; 					// number of path taps
   valarray<double> taps_delays;  	// time delay for all taps
@@ -144,15 +171,32 @@ class Link {
 
   valarray<double> carrier_loss;    // loss for each subcarrier
 
-  double doppler_spread;
+  // resampling of the taps at the subcarriers
+  const raisedcos_table* interp; // tap interpolation, shared by all links
+  const fft_plan* fft;           // FFT plan, shared by all links
+  unsigned max_samp;             // index of last nonzero time-domain sample
+  vector<double> samples;        // time-domain samples
+  vector<double> spectrum;       // FFT output
+  vector<unsigned> carrier_index; // FFT coefficient of each subcarrier
 
   valarray<double> path_loss;      // current average subcarrier path loss in dB
+  valarray<double> gain;    // 'path_loss' in linear scale, if 'gain_valid'
+  bool gain_valid;
   double path_loss_mean; // average path loss (without fading) in dB 
 
-  double time_diff_min; // link gain is not updated if last update
-  // happened less than 'time_diff_min' seconds ago
+  timestamp coherence;   // link gain is not updated if last update happened
+                         // at most 'coherence' before
+  timestamp next_update; // time after which link gain must be updated
+
+  const float* trace;  // subcarrier losses at multiples of 'coherence',
+                       // 0 if fading is synthesized
+  unsigned trace_len;  // number of samples in 'trace'
 
-  timestamp time_last; // time of latest link gain update
+  void play_trace(timestamp t);
+  // sets path loss at time 't' by interpolation of the trace
+
+  unsigned long n_hits;    // number of calls to 'fade' without update
+  unsigned long n_updates; // number of calls to 'fade' with update
 
 public:
   //Link() {}
@@ -160,12 +204,36 @@ public:
        double path_loss, // mean path loss in dB
        double fd,        // maximum Doppler spread in Hz
        random* r,        // pointer to random number generator
+       SimContext* x,    // pointer to simulation context
        unsigned ns,      // number of sinewaves in Jakes' model
-	   channel_model cm  // multipath channel model
+	   channel_model cm, // multipath channel model
+       timestamp tc      // coherence time
        );
 
-  valarray<double> fade(timestamp t); // returns the link gain amplitude at time 't' in dB
+  const valarray<double>& fade(timestamp t);
+  // returns the subcarrier path losses at time 't' in dB
+
+  const valarray<double>& fade_gain(timestamp t);
+  // returns the subcarrier path gains at time 't' in linear scale
+  unsigned long long trace_key(unsigned long long h) const;
+  // returns hash identifying the fading process of this link, continuing from
+  // hash 'h'
+
+  void write_trace(ostream& os, unsigned n);
+  // synthesizes subcarrier losses at 'n' multiples of the coherence time and
+  // writes them to 'os' as floats
+
+  void set_trace(const float* p, unsigned n);
+  // plays fading from 'n' samples at 'p', written by 'write_trace'
+
+  unsigned long get_hits() const {return n_hits;}
+  unsigned long get_updates() const {return n_updates;}
+  // return number of calls to 'fade' with and without update of link gain
   void resample();
+  // calculates subcarrier losses from the tap amplitudes
+
+  void init_resample();
+  // selects FFT length and subcarrier coefficients, allocates buffers
 
   bool belong(term_pair t) const {return t == terms;}
   // returns true if this link corresponds to 't', false otherwise
@@ -180,19 +248,54 @@ public:
 // struct pack_struct                                                         //
 //                                                                            //
 // structure containing a packet and the interference level to this packet at //
-// the target terminal                                                        //
+// the target terminal, for each subcarrier. The identification numbers of    //
+// source and target PHYs and the linear transmit power are stored to speed   //
+// up interference calculation.                                               //
 ////////////////////////////////////////////////////////////////////////////////
 struct pack_struct {
   MPDU pck;
-  double interf;
-  double interf_max;
+  unsigned source; // identification number of source PHY
+  unsigned target; // identification number of target PHY
+  double power;    // transmit power in linear scale
+  valarray<double> interf;     // current interference at each subcarrier, mW
+  valarray<double> interf_max; // highest interference at each subcarrier
 
-  pack_struct(MPDU p): pck(p), interf(0), interf_max(0) {}
-  
-  pack_struct(MPDU p, double d): pck(p), interf(d), interf_max(d) {}
+  pack_struct(MPDU p, unsigned nsub);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// class waiting_list                                                         //
+//                                                                            //
+// PHYs that requested notification of channel occupation or release, in      //
+// order of request.                                                          //
+// The position of each PHY is kept by PHY identification number, so that     //
+// 'push_back' and 'remove' take constant time. A removed PHY leaves an       //
+// empty entry (null pointer) that is skipped by the notification loop and    //
+// squeezed out by 'compact', which must not be called while the entries are  //
+// being iterated. Memory is only allocated when the list grows beyond its    //
+// largest size so far.                                                       //
+////////////////////////////////////////////////////////////////////////////////
+class waiting_list {
+  vector<PHY*> entry;  // PHYs in order of request, 0 if removed
+  vector<int> slot;    // index in 'entry' by PHY identification number,
+                       // -1 if PHY is not in list
+  unsigned n_removed;  // number of empty entries
+
+public:
+  waiting_list() : n_removed(0) {}
 
-  pack_struct(MPDU p, double d1, double d2)
-             : pck(p), interf(d1), interf_max(d2) {}
+  void push_back(PHY* p);
+  // appends '*p' if it is not in list yet
+
+  void remove(PHY* p);
+  // removes '*p' if it is in list
+
+  void compact();
+  // removes empty entries, preserving the order of the remaining PHYs
+
+  size_t size() const {return entry.size();}
+  PHY* operator[] (size_t i) const {return entry[i];}
+  // entry 'i', which is 0 if the PHY was removed
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -205,6 +308,7 @@ class Channel_private {
 protected:
   Scheduler *ptr2sch; // pointer to scheduler
   random *rand_gen;  // pointer to random number generator
+  SimContext* ctx;   // pointer to simulation context
 
   log_file*  mylog;
   bool       logflag;  // true if Channel events should be logged
@@ -216,28 +320,77 @@ protected:
   double DopplerSpread_Hz;
   unsigned NumberSinus;
   channel_model cModel;
+  timestamp CoherenceTime; // minimum interval between fading updates
+  mapped_file* trace;      // fading trace of all links, 0 if not used
+  double TxPowerMax_dBm;  // maximum transmit power
+  double RangeLoss_dB;    // maximum path loss between PHYs in range
+  double CCASensitivity_dBm; // carrier sensitivity level of all terminals
+  bool InterfFading;      // true if interference links are time-variant
 
   vector<PHY*> term_list; // list of all active terminals
   vector<Link> links;     // list of all active links
 
   list<pack_struct> air_pack; // list of packets currently transmitted
 
-  map<term_pair,double> path_loss;
-  // channel gains between all terminals, including both active links and those
-  // that cause only interference
+  unsigned n_phy;          // dimension of path loss matrices
+  vector<double> loss_dB;  // mean path loss in dB
+  vector<double> gain_lin; // mean path gain in linear scale
+  // symmetric matrices of channel gains between all terminals, including both
+  // active links and those that cause only interference, indexed by PHY
+  // identification numbers. There is no loss between a PHY and itself.
+  vector<int> link_index;
+  // position in 'links' of the link between two PHYs, -1 if there is no link,
+  // indexed as the path loss matrices
 
-  list<PHY*> waiting_list_free; // list of terminals that requested notification
-                                // when channel is released
-  list<PHY*> waiting_list_busy; // list of terminals that requested notification
-                                // when channel is occupied
+  vector< vector<PHY*> > neighbours;
+  // PHYs in range of each PHY (including itself), in the order of 'term_list',
+  // indexed by PHY identification number
 
+  waiting_list waiting_list_free; // terminals that requested notification
+                                  // when channel is released
+  waiting_list waiting_list_busy; // terminals that requested notification
+                                  // when channel is occupied
+  vector<Contention*> domains;  // BSSs with analytic backoff, always notified
 
-  void busy_channel_message(MPDU pck);
-  void free_channel_message(MPDU pck);
-  // tell all the terminals requesting notification that channel was
-  // occupied/released by packet 'pck'
+
+  void busy_channel_message(const pack_struct& ps);
+  void free_channel_message(const pack_struct& ps);
+  // tell all the terminals requesting notification and all BSSs with
+  // analytic backoff that channel was occupied/released by packet 'pck'
 
   void new_term(PHY* t); // adds new terminal to the channel
+
+  double mean_loss(unsigned i, unsigned j) const {
+    return loss_dB[i * n_phy + j];}
+  double mean_gain(unsigned i, unsigned j) const {
+    return gain_lin[i * n_phy + j];}
+  // return path loss in dB and path gain in linear scale between the PHYs
+  // with identification numbers 'i' and 'j'
+
+  bool in_range(const pack_struct& ps, unsigned i) const {
+    return (ps.pck).get_power() > TxPowerMax_dBm
+           || mean_loss(ps.source, i) <= RangeLoss_dB;}
+  // returns true if packet 'ps' may be received above carrier sensitivity
+  // level by PHY with identification number 'i'
+
+  Link* add_link(PHY* pt1, PHY* pt2);
+  // creates time-variant link between two PHYs known to the channel
+
+  Link* find_link(unsigned i, unsigned j);
+  // returns pointer to link between the PHYs with identification numbers 'i'
+  // and 'j', 0 if there is none
+
+  void add_interf(valarray<double>& acc, const pack_struct& ps,
+                  unsigned target);
+  // adds interference of packet 'ps' at PHY with identification number
+  // 'target' to the subcarrier interference levels 'acc'. The faded gain is
+  // used if there is a time-variant link, the mean gain otherwise.
+
+  void add_interference(pack_struct& ps);
+  // adds interference caused by new packet 'ps' to all packets on the air and
+  // sets interference level at the target of 'ps'
+  void remove_interference(const pack_struct& ps);
+  // removes interference caused by packet 'ps' from all packets on the air
   
   void stop_send_all(long_integer pack_id);
   void stop_send_one(long_integer pack_id);
@@ -248,13 +401,6 @@ public:
 
   virtual double get_interf_dBm(PHY* t) = 0;
   // returns interference level in dBm at PHY '*t'
-
-  ////////////////////////////////////
-  // wrapper functions for call-back
-  static void wrapper_to_stop_send_all (void* p, long_integer i) {
-                                      ((Channel_private*) p)->stop_send_all(i);}
-  static void wrapper_to_stop_send_one (void* p, long_integer i) {
-                                      ((Channel_private*) p)->stop_send_one(i);}
 };
 
 #endif
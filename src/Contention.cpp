@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2002-2015 by Microwave and Wireless Systems Laboratory, by Andre Barreto and Calil Queiroz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include <algorithm>
+
+#include "Contention.h"
+#include "MAC.h"
+#include "PHY.h"
+#include "Profiler.h"
+#include "SimContext.h"
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// enum backoff_type                                                          //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////
+// output operator << //
+////////////////////////
+ostream& operator<< (ostream& os, const backoff_type& b) {
+  switch(b) {
+    case EVENT_DRIVEN: return os << "EVENT_DRIVEN";
+    case ANALYTIC: return os << "ANALYTIC";
+    case VALIDATE: return os << "VALIDATE";
+  }
+  return os;
+}
+
+///////////////////////
+// input operator >> //
+///////////////////////
+istream& operator>> (istream& is, backoff_type& b) {
+  string str;
+  is >> str;
+
+  if (str == "EVENT_DRIVEN") b = EVENT_DRIVEN;
+  else if (str == "ANALYTIC") b = ANALYTIC;
+  else if (str == "VALIDATE") b = VALIDATE;
+  else is.clear(ios::failbit);
+
+  return is;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class Contention                                                           //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Contention constructor                                                     //
+////////////////////////////////////////////////////////////////////////////////
+Contention::Contention(Scheduler* s, SimContext* x, PHY* m, double cca)
+                      : ptr2sch(s), ctx(x), medium(m), CCASensitivity_dBm(cca),
+                        busy(false), next(0) {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Contention::join                                                           //
+//                                                                            //
+// adds MAC 'm' to the members of the BSS. If the medium is idle, 'm' becomes //
+// the next winner if it expires earlier than the current one.                //
+////////////////////////////////////////////////////////////////////////////////
+void Contention::join(MAC_private* m) {
+BEGIN_PROF("Contention::join")
+
+  if (find(members.begin(), members.end(), m) == members.end())
+    members.push_back(m);
+
+  if (busy) {
+    // countdown resumes when medium is released
+    m->time_to_send = not_a_timestamp();
+
+  } else if (!next || m->time_to_send < next->time_to_send) {
+    ptr2sch->remove(expiry_event);
+    next = m;
+    expiry_event = ptr2sch->schedule(Event::callback<Contention,
+        &Contention::expire>(next->time_to_send, this));
+  }
+
+END_PROF("Contention::join")
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Contention::channel_occupied                                               //
+//                                                                            //
+// if the interference at the medium reaches the sensitivity level, freeze    //
+// the backoff counters of all members and cancel the next expiration         //
+////////////////////////////////////////////////////////////////////////////////
+void Contention::channel_occupied(double interf) {
+BEGIN_PROF("Contention::channel_occupied")
+
+  if (!busy && interf >= CCASensitivity_dBm) {
+    busy = true;
+
+    for (vector<MAC_private*>::iterator it = members.begin();
+         it != members.end(); ++it)
+      if (!(*it)->time_to_send.is_not_a_timestamp()) (*it)->freeze_backoff();
+
+    ptr2sch->remove(expiry_event);
+    next = 0;
+  }
+
+END_PROF("Contention::channel_occupied")
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Contention::channel_released                                               //
+//                                                                            //
+// if the interference at the medium falls below the sensitivity level,       //
+// resume the countdowns of all members and schedule the first expiration     //
+////////////////////////////////////////////////////////////////////////////////
+void Contention::channel_released(double interf) {
+BEGIN_PROF("Contention::channel_released")
+
+  if (busy && interf < CCASensitivity_dBm) {
+    busy = false;
+
+    for (vector<MAC_private*>::iterator it = members.begin();
+         it != members.end(); ++it)
+      (*it)->resume_backoff();
+
+    resolve();
+  }
+
+END_PROF("Contention::channel_released")
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Contention::resolve                                                        //
+////////////////////////////////////////////////////////////////////////////////
+void Contention::resolve() {
+
+  next = 0;
+  for (vector<MAC_private*>::iterator it = members.begin();
+       it != members.end(); ++it)
+    if (!next || (*it)->time_to_send < next->time_to_send) next = *it;
+
+  if (next)
+    expiry_event = ptr2sch->schedule(Event::callback<Contention,
+        &Contention::expire>(next->time_to_send, this));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Contention::expire                                                         //
+//                                                                            //
+// the winner leaves the BSS and starts its TXOP. Its transmission usually    //
+// makes the medium busy, otherwise the next winner is resolved.              //
+////////////////////////////////////////////////////////////////////////////////
+void Contention::expire() {
+BEGIN_PROF("Contention::expire")
+
+  MAC_private* winner = next;
+  next = 0;
+  expiry_event = event_handle();
+  members.erase(find(members.begin(), members.end(), winner));
+
+  winner->start_TXOP();
+
+  if (!busy && !next) resolve();
+
+END_PROF("Contention::expire")
+}
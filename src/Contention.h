@@ -0,0 +1,119 @@
+/*
+* Copyright (c) 2002-2015 by Microwave and Wireless Systems Laboratory, by Andre Barreto and Calil Queiroz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef _Contention_h
+#define _Contention_h 1
+
+#include <vector>
+#include <iostream>
+
+#include "Scheduler.h"
+#include "timestamp.h"
+
+class MAC_private;
+class PHY;
+class SimContext;
+
+////////////////////////////////////////////////////////////////////////////////
+// enum backoff_type                                                          //
+//                                                                            //
+// engine of the backoff countdown of all MACs                                //
+//  EVENT_DRIVEN: each MAC schedules its own transmission and is notified by  //
+//                the channel of every busy/free transition of its PHY        //
+//  ANALYTIC:     the countdowns of each BSS are resolved by a Contention     //
+//                object                                                      //
+//  VALIDATE:     as ANALYTIC, but each iteration is repeated with            //
+//                EVENT_DRIVEN and the throughputs of both engines are        //
+//                compared                                                    //
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {EVENT_DRIVEN, ANALYTIC, VALIDATE} backoff_type;
+
+ostream& operator<< (ostream& os, const backoff_type& b);
+istream& operator>> (istream& is, backoff_type& b);
+
+////////////////////////////////////////////////////////////////////////////////
+// class Contention                                                           //
+//                                                                            //
+// analytic backoff countdown of the MACs of one BSS                          //
+//                                                                            //
+// Usage:                                                                     //
+// - one object is created for each access point, whose PHY is the 'medium'   //
+//   of the BSS, and registered at the channel with 'contention_request'.     //
+//   The channel then calls 'channel_occupied' and 'channel_released' with    //
+//   the interference level at the medium whenever a packet in range starts   //
+//   or stops being transmitted.                                              //
+// - a MAC of the BSS that begins its countdown calls 'join'. While the       //
+//   medium is idle, the MAC keeps its backoff resume time in 'time_to_send'. //
+//   Only one event is scheduled, for the member that expires first (ties are //
+//   won by the member that joined first), which is removed from the BSS and  //
+//   starts its TXOP. If the medium is still idle, the next winner is         //
+//   resolved.                                                                //
+// - when the medium becomes busy, the backoff counters of all members are    //
+//   frozen at once. When it becomes idle, all countdowns resume after the    //
+//   AIFS, or after the NAV of the member if it is still set.                 //
+//                                                                            //
+// Remarks:                                                                   //
+// . channel occupation is sensed at the access point for all members, so     //
+//   that terminals hidden from each other defer as if they were not.         //
+// . a NAV reset by 'check_nav' does not shorten a resume time already set.   //
+////////////////////////////////////////////////////////////////////////////////
+class Contention {
+  Scheduler* ptr2sch;  // pointer to simulation scheduler
+  SimContext* ctx;     // pointer to simulation context
+  PHY* medium;         // PHY at which the channel occupation is sensed
+  double CCASensitivity_dBm; // carrier sensitivity level
+
+  bool busy;                     // true if medium is busy
+  vector<MAC_private*> members;  // MACs counting down, in order of joining
+  MAC_private* next;             // member that expires first, 0 if none
+  event_handle expiry_event;     // scheduled expiration of 'next'
+
+  void resolve();
+  // finds the member that expires first and schedules its expiration
+
+  void expire();
+  // backoff of 'next' has expired, start its TXOP
+
+  Contention(const Contention&);
+  Contention& operator= (const Contention&);
+
+public:
+  Contention(Scheduler* s,   // pointer to simulation scheduler
+             SimContext* x,  // pointer to simulation context
+             PHY* m,         // PHY of the access point
+             double cca      // carrier sensitivity level in dBm
+            );
+
+  PHY* get_medium() const {return medium;}
+  bool is_busy() const {return busy;}
+
+  void join(MAC_private* m);
+  // MAC 'm' begins or continues its countdown, its backoff resume time must
+  // be set if the medium is idle
+
+  void channel_occupied(double interf);
+  void channel_released(double interf);
+  // a packet started/stopped being transmitted, with new interference level
+  // 'interf' at the medium
+};
+
+#endif
@@ -24,7 +24,8 @@
 #include "PHY.h"
 #include "Terminal.h"
 #include "Profiler.h"
-#include "Standard.h"
+#include "SimContext.h"
+#include "Contention.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // IEEE 802.11a constant parameters                                           //
@@ -34,11 +35,53 @@ const timestamp DIFS = timestamp(34.0e-6);
 const timestamp SIFS = timestamp(16.0e-6);
 
 // timeout intervals
-inline timestamp ACK_Timeout(transmission_mode m) {
-	return SIFS + ack_duration(m) + 5;
+inline timestamp ACK_Timeout(SimContext* c, transmission_mode m) {
+	return SIFS + ack_duration(c, m) + 5;
 }
-inline timestamp BA_Timeout(transmission_mode m) {
-	return SIFS + ba_duration(m) + 5;
+inline timestamp BA_Timeout(SimContext* c, transmission_mode m) {
+	return SIFS + ba_duration(c, m) + 5;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// class ac_queue                                                             //
+////////////////////////////////////////////////////////////////////////////////
+unsigned ac_queue::slot_of(Terminal* t) {
+	unsigned id = t->get_id();
+	if (id >= slot.size()) slot.resize(id+1, -1);
+	if (slot[id] < 0) {
+		slot[id] = sub.size();
+		sub.push_back(deque<MSDU>());
+	}
+	return slot[id];
+}
+
+void ac_queue::push_back(const MSDU& p) {
+	unsigned s = slot_of(p.get_target());
+	if (sub[s].empty()) turn.push_back(s);
+	sub[s].push_back(p);
+	++n;
+}
+
+void ac_queue::push_front(const MSDU& p) {
+	unsigned s = slot_of(p.get_target());
+	if (sub[s].empty()) turn.push_front(s);
+	sub[s].push_front(p);
+	++n;
+}
+
+void ac_queue::pop_front(bool next) {
+	unsigned s = turn.front();
+	sub[s].pop_front();
+	--n;
+	if (sub[s].empty()) turn.pop_front();
+	else if (next) next_receiver();
+}
+
+void ac_queue::next_receiver() {
+	if (turn.size() > 1) {
+		turn.push_back(turn.front());
+		turn.pop_front();
+	}
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -48,10 +91,13 @@ inline timestamp BA_Timeout(transmission_mode m) {
 ////////////////////////////////////////////////////////////////////////////////
 // MAC constructor                                                            //
 ////////////////////////////////////////////////////////////////////////////////
-MAC::MAC(Terminal* t, Scheduler* s, random *r, log_file* l, mac_struct mac){
+MAC::MAC(Terminal* t, Scheduler* s, random *r, SimContext* x, log_file* l,
+		mac_struct mac){
 	term = t;
 	ptr2sch = s;
+	contention = 0;
 	randgen = r;
+	ctx = x;
 
 	mylog = l;
 	logflag = (*mylog)(log_type::mac);
@@ -61,14 +107,14 @@ MAC::MAC(Terminal* t, Scheduler* s, random *r, log_file* l, mac_struct mac){
 	frag_thresh = mac.frag_thresh;
 	max_queue_size = mac.queue_size;
 
-	for(int k = 0; k < 5; k++)	{
+	for(int k = 0; k < n_ACs; k++)	{
 		accCat auxAC = allACs[k];
-		deque<MSDU> auxQue;
-		packet_queue[auxAC] = auxQue;
 		BOC_ACs[auxAC] = 0;
 		CW_ACs[auxAC] = 0;
 		BOC_flag[auxAC] = true;
 	}
+	queue_size = 0;
+	myAC = AC_BK; // until the first internal contention
 
 	BAAggFlag = mac.BAAgg;
 	TXOPflag = false;
@@ -89,8 +135,8 @@ MAC::MAC(Terminal* t, Scheduler* s, random *r, log_file* l, mac_struct mac){
 
 	countdown_flag = false;
 
-	cts_duration = (MPDU(CTS, 0, 0, 0, MCS0)).get_duration();
-	rts_duration = (MPDU(RTS, 0, 0, 0, MCS0)).get_duration();
+	cts_duration = (MPDU(ctx, CTS, 0, 0, 0, MCS0)).get_duration();
+	rts_duration = (MPDU(ctx, RTS, 0, 0, 0, MCS0)).get_duration();
 	CTS_Timeout = SIFS + cts_duration + 5;
 
 }
@@ -135,7 +181,7 @@ void MAC_private::set_myAC(accCat AC) {
 		break;
 	}
 
-	if(Standard::get_standard() == dot11ah) TXOPmax = 10*TXOPmax;
+	if(ctx->standard.get_standard() == dot11ah) TXOPmax = 10*TXOPmax;
 
 	AIFS = SIFS + timestamp(AIFSN)*aSlotTime;
 	TXOPflag = false;
@@ -162,14 +208,14 @@ void MAC_private::ack_timed_out () {
 	}
 
 #ifdef _SAVE_RATE_ADAPT
-	timestamp t_aux = ptr2sch->now() - pck.get_duration() - ACK_Timeout(pck.get_mode());
+	timestamp t_aux = ptr2sch->now() - pck.get_duration() - ACK_Timeout(ctx, pck.get_mode());
 	if (pck.get_nbytes_mac() >= RTS_threshold) {
 		t_aux = t_aux - rts_duration - cts_duration - 2*SIFS;
 	}
 	rate_adapt_file_rt << setw(10) << double(t_aux) << ','
 			<< setw(6) << get_id() << ','
 			<< setw(6) << (msdu.get_target())->get_id() << ','
-			<< setw(6) << Standard::tx_mode_to_double(pck.get_mode()) << ','
+			<< setw(6) << ctx->standard.tx_mode_to_double(pck.get_mode()) << ','
 			<< 0 << endl;
 #endif
 
@@ -181,7 +227,7 @@ void MAC_private::ack_timed_out () {
 
 		term->macUnitdataMaxRetry(msdu);
 
-		packet_queue[myAC].pop_front();
+		dequeue(myAC);
 		// If there is a packet on the queue, transmit next msdu
 		if (get_queue_size()) new_msdu();
 
@@ -197,7 +243,7 @@ void MAC_private::ack_timed_out () {
 
 		if(TXOPmax == timestamp(0))	tx_attempt();
 		else if(TXOPflag) {
-			ptr2sch->remove((void*)(&wrapper_to_end_TXOP), (void*)this);
+			ptr2sch->remove(end_TXOP_event);
 			end_TXOP();
 		}
 	}
@@ -248,10 +294,14 @@ void MAC_private::begin_countdown() {
 		<< ", schedule function transmit at time "
 		<< time_to_send << endl;
 
-	ptr2sch->schedule(Event(time_to_send,(void*)&wrapper_to_start_TXOP,
-			(void*)this));
+	if (contention) {
+		contention->join(this);
+	} else {
+		start_TXOP_event = ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::start_TXOP>(time_to_send, this));
 
-	myphy->notify_busy_channel();
+		myphy->notify_busy_channel();
+	}
 
 	countdown_flag = true;
 
@@ -266,8 +316,18 @@ void MAC_private::begin_countdown() {
 void MAC::phyCCA_busy() {
 	BEGIN_PROF("MAC::phyCCA_busy")
 
-	//////////////////////////////////////////
-	// stop countdown and cancel transmission
+	freeze_backoff();
+
+	END_PROF("MAC::phyCCA_busy")
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// MAC_private::freeze_backoff                                                //
+//                                                                            //
+// stop countdown and cancel transmission                                     //
+////////////////////////////////////////////////////////////////////////////////
+void MAC_private::freeze_backoff() {
+
 	timestamp time_diff = time_to_send - ptr2sch->now();
 	if (time_diff < timestamp(BOC_ACs[myAC]) * aSlotTime) {
 		BOC_ACs[myAC] = time_diff / aSlotTime;
@@ -279,9 +339,7 @@ void MAC::phyCCA_busy() {
 			<< BOC_ACs[myAC] << endl;
 
 	time_to_send = not_a_timestamp();
-	ptr2sch->remove((void*)(&wrapper_to_start_TXOP), (void*)this);
-
-	END_PROF("MAC::phyCCA_busy")
+	ptr2sch->remove(start_TXOP_event);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -298,7 +356,8 @@ void MAC::phyCCA_free() {
 	if (now <= NAV) {
 
 		// if NAV is set, try again later
-		ptr2sch->schedule(Event(NAV+1,(void*)&wrapper_to_end_nav, (void*)this));
+		ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC::end_nav>(NAV+1, this));
 		return;
 	}
 
@@ -306,8 +365,8 @@ void MAC::phyCCA_free() {
 		// resume countdown
 
 		time_to_send = now + AIFS + timestamp(BOC_ACs[myAC]) * aSlotTime;
-		ptr2sch->schedule(Event(time_to_send, (void*)(&wrapper_to_start_TXOP),
-				(void*)this));
+		start_TXOP_event = ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC::start_TXOP>(time_to_send, this));
 
 		if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 				<< " received free-channel message\n    "
@@ -323,6 +382,28 @@ void MAC::phyCCA_free() {
 	END_PROF("MAC::phyCCA_free")
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// MAC_private::resume_backoff                                                //
+//                                                                            //
+// channel became free for the BSS, schedule transmission for the end of the  //
+// NAV plus AIFS and backoff counter. The transmission itself is scheduled by //
+// the BSS.                                                                   //
+////////////////////////////////////////////////////////////////////////////////
+void MAC_private::resume_backoff() {
+
+	timestamp now = ptr2sch->now();
+	timestamp start = (now <= NAV) ? NAV+1 : now;
+
+	time_to_send = start + AIFS + timestamp(BOC_ACs[myAC]) * aSlotTime;
+
+	if (logflag) *mylog << "\n" << now << "sec., " << *term
+			<< " channel is free, "
+			<< (countdown_flag ? "resume" : "begin") << " countdown"
+			<< ", new transmission scheduled to " << time_to_send << endl;
+
+	countdown_flag = true;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // MAC_private::check_nav                                                     //
 //                                                                            //
@@ -356,7 +437,7 @@ void MAC_private::cts_timed_out () {
 	rate_adapt_file_rt << setw(10) << double(t_aux) << ','
 			<< setw(6) << get_id() << ','
 			<< setw(6) << (msdu.get_target())->get_id() << ','
-			<< setw(6) << Standard::tx_mode_to_double(pck.get_mode()) << ','
+			<< setw(6) << ctx->standard.tx_mode_to_double(pck.get_mode()) << ','
 			<< -1 << endl;
 #endif
 
@@ -383,7 +464,7 @@ void MAC_private::cts_timed_out () {
 
 		term->macUnitdataMaxRetry(msdu);
 
-		packet_queue[myAC].pop_front();
+		dequeue(myAC);
 		if (get_queue_size()) new_msdu();
 
 	} else {
@@ -418,7 +499,8 @@ void MAC_private::end_nav() {
 	if (now <= NAV) {
 
 		// try again later
-		ptr2sch->schedule(Event(NAV+1,(void*)&wrapper_to_end_nav, (void*)this));
+		ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::end_nav>(NAV+1, this));
 		myphy->cancel_notify_free_channel();
 
 		END_PROF("MAC::end_nav")
@@ -438,8 +520,8 @@ void MAC_private::end_nav() {
 	if (countdown_flag) {
 
 		time_to_send = now + AIFS + timestamp(BOC_ACs[myAC]) * aSlotTime;
-		ptr2sch->schedule(Event(time_to_send, (void*)(&wrapper_to_start_TXOP),
-				(void*)this));
+		start_TXOP_event = ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::start_TXOP>(time_to_send, this));
 
 		if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 				<< ", channel released according to NAV"
@@ -492,6 +574,8 @@ void MAC_private::new_msdu() {
 	// Recalculate myAC, if not during TXOP or TXOP is going to end or has ended
 	if(!TXOPflag){
 		internal_contention();
+	} else if(!packet_queue[myAC].size()) {
+		return; // only other ACs have MSDUs, wait for end of TXOP
 	}
 
 	msdu = packet_queue[myAC].front();
@@ -520,7 +604,8 @@ void MAC_private::new_msdu() {
 	}
 
 	if(t != timestamp(0)) {
-		ptr2sch->schedule(Event(t,(void*)&wrapper_to_tx_attempt, (void*)this));
+		ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::tx_attempt>(t, this));
 	}
 }    
 
@@ -544,7 +629,8 @@ void MAC_private::receive_bc(MPDU p) {
 	if (p.get_type() == RTS) {
 
 		timestamp t = ptr2sch->now() + 2*SIFS + cts_duration + 2*aSlotTime;
-		ptr2sch->schedule(Event(t,(void*)&wrapper_to_check_nav,(void*)this));
+		ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::check_nav>(t, this));
 	}
 
 	END_PROF("MAC::receive_bc")
@@ -572,7 +658,7 @@ void MAC_private::receive_this(MPDU p) {
 					"Station received ACK during TXOP with BAAggFlag set"));
 		}
 
-		ptr2sch->remove((void*)(&wrapper_to_ack_timed_out), (void*)this);
+		ptr2sch->remove(ack_timeout_event);
 
 		if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 				<< " received ACK for packet "
@@ -581,14 +667,14 @@ void MAC_private::receive_this(MPDU p) {
 
 #ifdef _SAVE_RATE_ADAPT
 		timestamp t_aux = ptr2sch->now() - pck.get_duration() - SIFS
-				- ack_duration(pck.get_mode());
+				- ack_duration(ctx, pck.get_mode());
 		if (pck.get_nbytes_mac() >= RTS_threshold) {
 			t_aux = t_aux - rts_duration - cts_duration - 2*SIFS;
 		}
 		rate_adapt_file_rt << setw(10) << double(t_aux) << ','
 				<< setw(6) << get_id() << ','
 				<< setw(6) << (msdu.get_target())->get_id() << ','
-				<< setw(6) << Standard::tx_mode_to_double(pck.get_mode()) << ','
+				<< setw(6) << ctx->standard.tx_mode_to_double(pck.get_mode()) << ','
 				<< 1 << endl;
 #endif
 
@@ -600,7 +686,7 @@ void MAC_private::receive_this(MPDU p) {
 			// Indicate LA success if not during TXOP
 			if(!TXOPflag) term->la_success(msdu.get_target(), true);
 
-			packet_queue[myAC].pop_front();
+			dequeue(myAC);
 			if (get_queue_size()) new_msdu();
 
 			break;
@@ -620,11 +706,11 @@ void MAC_private::receive_this(MPDU p) {
 				pl = msdu.get_nbytes() % frag_thresh;
 				if (!pl) pl = frag_thresh;
 
-				newnav = now + 2*SIFS + pck.get_duration() + ack_duration(p.get_mode());
+				newnav = now + 2*SIFS + pck.get_duration() + ack_duration(ctx, p.get_mode());
 			}
 			else {
 				pl = frag_thresh;
-				newnav = now + 4*SIFS + 2*pck.get_duration() + 2*ack_duration(p.get_mode());
+				newnav = now + 4*SIFS + 2*pck.get_duration() + 2*ack_duration(ctx, p.get_mode());
 			}
 
 			if(TXOPflag) newnav = TXOPend;
@@ -635,11 +721,11 @@ void MAC_private::receive_this(MPDU p) {
 					<< now + SIFS << endl;
 
 
-			pck = DataMPDU(msdu, pl, current_frag, nfrags, power_dBm, p.get_mode(),
+			pck = DataMPDU(ctx, msdu, pl, current_frag, nfrags, power_dBm, p.get_mode(),
 					newnav,normalACK,true);
 
-			ptr2sch->schedule(Event(now+SIFS, (void*)(&wrapper_to_send_data),
-					(void*)this));
+			ptr2sch->schedule(Event::callback<MAC_private,
+					&MAC_private::send_data>(now+SIFS, this));
 			break;
 		}
 	}
@@ -653,8 +739,8 @@ void MAC_private::receive_this(MPDU p) {
 		switch(p.get_ACKpol()) {
 		case normalACK : {
 			timestamp t_ack = now + SIFS;
-			ptr2sch->schedule(Event(t_ack, (void*)(&wrapper_to_send_ack),
-					(void*)this, p.get_source()));
+			ptr2sch->schedule(Event::callback<MAC_private, Terminal,
+					&MAC_private::send_ack>(t_ack, this, p.get_source()));
 
 			if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 					<< " received " << p
@@ -663,11 +749,12 @@ void MAC_private::receive_this(MPDU p) {
 			break;
 		}
 		case blockACK : {
-			pcks2ACK_ids.push_back(p.get_id());
+			const vector<long_integer>& sub = p.get_subframes();
+			pcks2ACK_ids.insert(pcks2ACK_ids.end(), sub.begin(), sub.end());
 			if(time_to_send_BA == timestamp(0)) {
-				time_to_send_BA = NAV - ba_duration(p.get_mode()) - timestamp(1);
-				ptr2sch->schedule(Event(time_to_send_BA, (void*)(&wrapper_to_send_ba),
-						(void*)this, p.get_source()));
+				time_to_send_BA = NAV - ba_duration(ctx, p.get_mode()) - timestamp(1);
+				ptr2sch->schedule(Event::callback<MAC_private, Terminal,
+						&MAC_private::send_ba>(time_to_send_BA, this, p.get_source()));
 			}
 			if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 					<< " received " << p << " during block ACK session. " << endl;
@@ -696,8 +783,8 @@ void MAC_private::receive_this(MPDU p) {
 		// update NAV
 		NAV_RTS = NAV = p.get_nav();
 
-		ptr2sch->schedule(Event(t_cts, (void*)(&wrapper_to_send_cts),
-				(void*)this, p.get_source()));
+		ptr2sch->schedule(Event::callback<MAC_private, Terminal,
+				&MAC_private::send_cts>(t_cts, this, p.get_source()));
 
 		if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 				<< " received " << p << ", channel is free"
@@ -710,7 +797,7 @@ void MAC_private::receive_this(MPDU p) {
 	////////////////////////////////////////
 	// CTS received, transmit data packet
 	case CTS : {
-		ptr2sch->remove((void*)(&wrapper_to_cts_timed_out), (void*)this);
+		ptr2sch->remove(cts_timeout_event);
 
 		timestamp t_data = now + SIFS;
 
@@ -719,9 +806,11 @@ void MAC_private::receive_this(MPDU p) {
 		 */
 		if(TXOPflag) {
 			if(BAAggFlag) preambFlag = true;
-			ptr2sch->schedule(Event(t_data, (void*)(&wrapper_to_tx_attempt),(void*)this));
+			ptr2sch->schedule(Event::callback<MAC_private,
+					&MAC_private::tx_attempt>(t_data, this));
 		}
-		else ptr2sch->schedule(Event(t_data, (void*)(&wrapper_to_send_data),(void*)this));
+		else ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::send_data>(t_data, this));
 
 		if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 				<< " received " << p
@@ -729,14 +818,15 @@ void MAC_private::receive_this(MPDU p) {
 				<< pck.get_id() << " at " << t_data << endl;
 
 		// Schedule the end of the TXOP
-		if(TXOPflag) ptr2sch->schedule(Event(TXOPend,(void*)&wrapper_to_end_TXOP,(void*)this));
+		if(TXOPflag) end_TXOP_event = ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::end_TXOP>(TXOPend, this));
 
 		break;
 	}
 	////////////////////////////////////////
 	// CTS received, transmit data packet
 	case BA : {
-		ptr2sch->remove((void*)(&wrapper_to_ba_timed_out), (void*)this);
+		ptr2sch->remove(ba_timeout_event);
 
 		if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 				<< " received " << p << ", that acknowledges packets ";
@@ -762,7 +852,7 @@ void MAC_private::receive_this(MPDU p) {
 void MAC_private::requeue_packets(vector<long_integer> bapcks) {
 	BEGIN_PROF("MAC::requeue_packets")
 
-	timestamp auxDur = ba_duration(pck.get_mode()) + SIFS;
+	timestamp auxDur = ba_duration(ctx, pck.get_mode()) + SIFS;
 
 	for(int k = pcks2ACK_ids.size() - 1; k >= 0 ; k--) {
 		if(find(bapcks.begin(), bapcks.end(), pcks2ACK_ids[k]) != bapcks.end()) {
@@ -781,7 +871,7 @@ void MAC_private::requeue_packets(vector<long_integer> bapcks) {
 				if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 						<< ": Packet " << pcks2ACK_ids[k] << " not acknowledged. Retry counter: "
 						<< pcks2reque[k].get_retry_count() << endl;
-				packet_queue[myAC].push_front(pcks2reque[k]);
+				requeue(myAC, pcks2reque[k]);
 			}
 		}
 		auxDur += pcktsDur[k];
@@ -801,12 +891,12 @@ void MAC_private::send_ack(Terminal *to) {
 	BEGIN_PROF("MAC::send_ack")
 
 	// transmit ACK with data rate of received data packet
-	//bool send2all = (NAV > ptr2sch->now() + ack_duration(rx_mode))? true : false;
+	//bool send2all = (NAV > ptr2sch->now() + ack_duration(ctx, rx_mode))? true : false;
 
 	if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 			<< ": send ACK to " << *to << ", NAV = " << NAV << endl;
 
-	myphy->phyTxStartReq(MPDU(ACK,term, to, term->get_power(to, frag_thresh),
+	myphy->phyTxStartReq(MPDU(ctx, ACK,term, to, term->get_power(to, frag_thresh),
 			rx_mode, NAV), false);
 
 	END_PROF("MAC::send_ack")
@@ -824,7 +914,7 @@ void MAC_private::send_cts(Terminal *to) {
 	<< endl;
 
 	// always send CTS at 6Mbps
-	myphy->phyTxStartReq(MPDU(CTS, term, to, term->get_power(to, frag_thresh),
+	myphy->phyTxStartReq(MPDU(ctx, CTS, term, to, term->get_power(to, frag_thresh),
 			MCS0, NAV_RTS), true);
 
 	END_PROF("MAC::send_cts")
@@ -844,7 +934,7 @@ void MAC_private::send_ba(Terminal *to) {
 	if (logflag) *mylog << "." << endl;
 
 
-	MPDU bapck = MPDU(BA, term, to, term->get_power(to, frag_thresh),
+	MPDU bapck = MPDU(ctx, BA, term, to, term->get_power(to, frag_thresh),
 			rx_mode, NAV);
 	bapck.setPcks2Ack(pcks2ACK_ids);
 	myphy->phyTxStartReq(bapck, true);
@@ -864,59 +954,78 @@ void MAC_private::send_ba(Terminal *to) {
 void MAC_private::send_data() {
 	BEGIN_PROF("MAC::send_data")
 
+	if(TXOPflag && BAAggFlag) {
+		// 'pck' is the first subframe of an A-MPDU
+		aggreg_send();
+		END_PROF("MAC::send_data")
+		return;
+	}
+
 	NAV = ptr2sch->now() + pck.get_duration();
 
 	n_att_frags++;
-	tx_data_rate += Standard::tx_mode_to_double(pck.get_mode());
+	tx_data_rate += ctx->standard.tx_mode_to_double(pck.get_mode());
 
 	myphy->phyTxStartReq(pck,true);
 
-	if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
-			<< " : send " << pck;
-
-	if(TXOPflag && BAAggFlag) {
-		if (logflag) *mylog << ", during block ACK session." << endl;
+	timestamp t = NAV + ACK_Timeout(ctx, pck.get_mode());
 
-		pcks2ACK_ids.push_back(pck.get_id());
-		pcks2reque.push_back(msdu);
-		pcktsDur.push_back(pck.get_duration());
+	if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
+			<< " : send " << pck << ", ACK timeout scheduled for "<< t << endl;
 
-		timestamp t = ptr2sch->now() + pck.get_duration();
-		ptr2sch->schedule(Event(t,(void*)&wrapper_to_aggreg_send,(void*)this));
-	} else {
-		timestamp t = NAV + ACK_Timeout(pck.get_mode());
-		if (logflag) *mylog << ", ACK timeout scheduled for "<< t << endl;
-		ptr2sch->schedule(Event(t,(void*)&wrapper_to_ack_timed_out,(void*)this));
-	}
+	ack_timeout_event = ptr2sch->schedule(Event::callback<MAC_private,
+			&MAC_private::ack_timed_out>(t, this));
 
 	END_PROF("MAC::send_data")
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // MAC_private::aggreg_send                                                   //
+//                                                                            //
+// aggregates the fragments and MSDUs for termTXOP that fit before the BA     //
+// into one A-MPDU, beginning with 'pck', and transmits it as a single PPDU.  //
+// Subframes use the rate and power of the first one.                         //
 ////////////////////////////////////////////////////////////////////////////////
 void MAC_private::aggreg_send() {
 	BEGIN_PROF("MAC::aggreg_send")
 
-	if(ptr2sch->now() + 1 >= time_to_wait_BA ) {
-		if (current_frag == nfrags) packet_queue[myAC].pop_front();
-		ptr2sch->schedule(Event(TXOPend + 1,(void*)&wrapper_to_ba_timed_out,(void*)this));
-		return;
-	}
+	timestamp now = ptr2sch->now();
+	timestamp t = now; // end of latest subframe
+	MPDU ampdu = pck;  // first subframe carries the preamble
 
-	if (current_frag == nfrags) {
-		packet_queue[myAC].pop_front();
-		while((packet_queue[myAC].front()).get_target() != termTXOP) {
-			packet_queue[myAC].push_back(packet_queue[myAC].front());
-			packet_queue[myAC].pop_front();
-		}
-		if (get_queue_size()) new_msdu();
-	} else {
+	for(;;) {
+		n_att_frags++;
+		tx_data_rate += ctx->standard.tx_mode_to_double(pck.get_mode());
 
-		++current_frag;
+		if (logflag) *mylog << "\n" << now << "sec., " << *term
+				<< " : aggregate " << pck << ", during block ACK session." << endl;
 
-		unsigned pl;
+		pcks2ACK_ids.push_back(pck.get_id());
+		pcks2reque.push_back(msdu);
+		pcktsDur.push_back(pck.get_duration());
+		t = t + pck.get_duration();
+
+		// stop if BA time has come or if no MSDU for termTXOP is left.
+		// During the TXOP the turn stays with termTXOP, whose MSDUs are in front
+		if(t + 1 >= time_to_wait_BA || (current_frag == nfrags &&
+				packet_queue[myAC].front_receiver().size() == 1)) break;
+
+		if (current_frag == nfrags) {
+			dequeue(myAC);
+			BOC_flag[myAC] = true;
+
+			msdu = packet_queue[myAC].front();
+			msdu.set_tx_time(t);
+			t = t + 1;
+
+			nfrags = msdu.get_nbytes() / frag_thresh;
+			if (msdu.get_nbytes()%frag_thresh) ++nfrags;
+			current_frag = 1;
+		} else {
+			++current_frag;
+		}
 
+		unsigned pl;
 		if (current_frag == nfrags) {
 			pl = msdu.get_nbytes() % frag_thresh;
 			if (!pl) pl = frag_thresh;
@@ -925,20 +1034,39 @@ void MAC_private::aggreg_send() {
 			pl = frag_thresh;
 		}
 
-		if (logflag) *mylog << "    schedule transmission of fragment "
-				<< current_frag << " with " << pl
-				<< " bytes and NAV = " << TXOPend << " for "
-				<< ptr2sch->now() + SIFS << endl;
+		pck = DataMPDU(ctx, msdu, pl, current_frag, nfrags, power_dBm, pck.get_mode(),
+				TXOPend,blockACK,false);
+	}
 
-		pck = DataMPDU(msdu, pl, current_frag, nfrags, power_dBm, pck.get_mode(),
-				TXOPend,blockACK,preambFlag);
+	ampdu.make_ampdu(pcks2ACK_ids, t - now);
+	NAV = t;
 
-		send_data();
-	}
+	myphy->phyTxStartReq(ampdu,true);
+
+	if (logflag) *mylog << "\n" << now << "sec., " << *term
+			<< " : send " << ampdu << ", ends at " << t << endl;
+
+	ptr2sch->schedule(Event::callback<MAC_private,
+			&MAC_private::aggreg_end>(t, this));
 
 	END_PROF("MAC::aggreg_send")
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// MAC_private::aggreg_end                                                    //
+//                                                                            //
+// A-MPDU was transmitted, wait for BA                                        //
+////////////////////////////////////////////////////////////////////////////////
+void MAC_private::aggreg_end() {
+	BEGIN_PROF("MAC::aggreg_end")
+
+	if (current_frag == nfrags) dequeue(myAC);
+	ba_timeout_event = ptr2sch->schedule(Event::callback<MAC_private,
+			&MAC_private::ba_timed_out>(TXOPend + 1, this));
+
+	END_PROF("MAC::aggreg_end")
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // MAC_private::timeTXOP                                                     //
 //                                                                            //
@@ -965,71 +1093,71 @@ void MAC_private::start_TXOP() {
 			TXOPend = now + rts_duration + cts_duration + SIFS;
 			if(BAAggFlag) {
 				termTXOP = msdu.get_target();
-				TXOPend += 2*SIFS + ba_duration(which_mode);
+				TXOPend += 2*SIFS + ba_duration(ctx, which_mode);
 			}
 
 			power_dBm = term->get_power(msdu.get_target(), frag_thresh);
 
-			while(TXOPend < now + TXOPmax && count < packet_queue[myAC].size()){
+			// the TXOP serves the receiver whose turn it is
+			const deque<MSDU>& txop_queue = packet_queue[myAC].front_receiver();
 
-				MSDU auxmsdu = (packet_queue[myAC])[count];
+			while(TXOPend < now + TXOPmax && count < txop_queue.size()){
 
-				if(!BAAggFlag || auxmsdu.get_target() == termTXOP) {
+				const MSDU& auxmsdu = txop_queue[count];
 
-					auxTXOPend = TXOPend;
+				auxTXOPend = TXOPend;
 
-					// Determine number of fragments
-					auxNfrags = auxmsdu.get_nbytes() / frag_thresh;
-					if (auxmsdu.get_nbytes()%frag_thresh) ++auxNfrags;
+				// Determine number of fragments
+				auxNfrags = auxmsdu.get_nbytes() / frag_thresh;
+				if (auxmsdu.get_nbytes()%frag_thresh) ++auxNfrags;
 
-					// determine packet and duration of last fragment
-					lastpl = auxmsdu.get_nbytes() % frag_thresh;
-					if (!lastpl) lastpl = frag_thresh;
+				// determine packet and duration of last fragment
+				lastpl = auxmsdu.get_nbytes() % frag_thresh;
+				if (!lastpl) lastpl = frag_thresh;
 
-					ACKpolicy apol  = BAAggFlag ? blockACK:normalACK;
-					bool prea = ((count != 0) && BAAggFlag) ? false:true;
+				ACKpolicy apol  = BAAggFlag ? blockACK:normalACK;
+				bool prea = ((count != 0) && BAAggFlag) ? false:true;
 
-					DataMPDU auxpck = DataMPDU(frag_thresh, term, auxmsdu.get_target(),power_dBm,
-							which_mode,timestamp(0),0,0,0,0,apol,prea);
-					DataMPDU auxpckLast = DataMPDU(lastpl, term, auxmsdu.get_target(), power_dBm,
-							which_mode,timestamp(0),0,0,0,0,apol,prea);
+				DataMPDU auxpck = DataMPDU(ctx, frag_thresh, term, auxmsdu.get_target(),power_dBm,
+						which_mode,timestamp(0),0,0,0,0,apol,prea);
+				DataMPDU auxpckLast = DataMPDU(ctx, lastpl, term, auxmsdu.get_target(), power_dBm,
+						which_mode,timestamp(0),0,0,0,0,apol,prea);
 
-					TXOPend = TXOPend + auxpckLast.get_duration();
-					if(!BAAggFlag) TXOPend += timestamp(auxNfrags)*ack_duration(which_mode) + 2*SIFS;
-					else if(count != 0) TXOPend += timestamp(auxNfrags)*timestamp(1);
+				TXOPend = TXOPend + auxpckLast.get_duration();
+				if(!BAAggFlag) TXOPend += timestamp(auxNfrags)*ack_duration(ctx, which_mode) + 2*SIFS;
+				else if(count != 0) TXOPend += timestamp(auxNfrags)*timestamp(1);
 
-					if(auxNfrags != 1){
-						// Update TXOPend accordingly
-						TXOPend = TXOPend + timestamp(auxNfrags-1)*auxpck.get_duration();
-					}
+				if(auxNfrags != 1){
+					// Update TXOPend accordingly
+					TXOPend = TXOPend + timestamp(auxNfrags-1)*auxpck.get_duration();
+				}
 
-					if (!BAAggFlag) {
-						//If an RTS/CTS is needed:
-						// For not the last packet
-						if(auxNfrags != 1 && auxpck.get_nbytes_mac() >= RTS_threshold){
-							TXOPend = TXOPend + timestamp(auxNfrags-1)*(rts_duration + cts_duration +
-									SIFS + 1);
-						}
-						// For the last packet
-						if(auxpckLast.get_nbytes_mac() >= RTS_threshold) {
-							TXOPend = TXOPend + rts_duration + cts_duration + SIFS;
-						}
+				if (!BAAggFlag) {
+					//If an RTS/CTS is needed:
+					// For not the last packet
+					if(auxNfrags != 1 && auxpck.get_nbytes_mac() >= RTS_threshold){
+						TXOPend = TXOPend + timestamp(auxNfrags-1)*(rts_duration + cts_duration +
+								SIFS + 1);
+					}
+					// For the last packet
+					if(auxpckLast.get_nbytes_mac() >= RTS_threshold) {
+						TXOPend = TXOPend + rts_duration + cts_duration + SIFS;
 					}
 				}
 				count++;
 			}
 
 			if(TXOPend > now + TXOPmax) TXOPend = auxTXOPend;
-			if(BAAggFlag) time_to_wait_BA = TXOPend - SIFS - ba_duration(which_mode);
+			if(BAAggFlag) time_to_wait_BA = TXOPend - SIFS - ba_duration(ctx, which_mode);
 
 			TXOPend = TXOPend + 1;
 
 			if (logflag) *mylog << "\n >> " << ptr2sch->now() << "sec., " << *term
 					<< ", of Access Category " << myAC << " begins TXOP scheduled to end at "
-					<< TXOPend << "sec." << "\nPackets in queue = " << count << ". TXOP duration = "
+					<< TXOPend << "sec." << "\nPackets for receiver = " << count << ". TXOP duration = "
 					<< TXOPend - now << " sec." << endl;
 
-			myphy->phyTxStartReq(MPDU(RTS,term,msdu.get_target(),power_dBm,MCS0,TXOPend),
+			myphy->phyTxStartReq(MPDU(ctx, RTS,term,msdu.get_target(),power_dBm,MCS0,TXOPend),
 					true);
 
 			if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
@@ -1037,7 +1165,8 @@ void MAC_private::start_TXOP() {
 
 			NAV = ptr2sch->now() + rts_duration;
 			timestamp t = NAV + CTS_Timeout;
-			ptr2sch->schedule(Event(t,(void*)&wrapper_to_cts_timed_out,(void*)this));
+			cts_timeout_event = ptr2sch->schedule(Event::callback<MAC_private,
+					&MAC_private::cts_timed_out>(t, this));
 
 		} else { // If already during TXOP or station does not have TXOP
 			transmit();
@@ -1078,6 +1207,9 @@ void MAC_private::end_TXOP() {
 
 	TXOPla_win = success;
 
+	// next TXOP or channel access goes to the following receiver
+	if (packet_queue[myAC].size()) packet_queue[myAC].next_receiver();
+
 	if (get_queue_size() && time_to_wait_BA == timestamp(0)) {
 		new_msdu();
 	}
@@ -1210,16 +1342,16 @@ void MAC_private::transmit() {
 	myphy->cancel_notify_busy_channel();
 
 	ACKpolicy apol = (BAAggFlag && TXOPflag) ? blockACK : normalACK;
-	DataMPDU auxpck = DataMPDU(pl, term, msdu.get_target(), power_dBm,which_mode,timestamp(0),
+	DataMPDU auxpck = DataMPDU(ctx, pl, term, msdu.get_target(), power_dBm,which_mode,timestamp(0),
 			apol,preambFlag);
 
 	if (auxpck.get_nbytes_mac() < RTS_threshold) { // Basic DCF protocol, without RTS/CTS exchange
 
 		timestamp auxnav;
 		if(TXOPflag) auxnav = TXOPend;
-		else auxnav = ptr2sch->now() + auxpck.get_duration() + SIFS + ack_duration(which_mode);
+		else auxnav = ptr2sch->now() + auxpck.get_duration() + SIFS + ack_duration(ctx, which_mode);
 
-		pck = DataMPDU (msdu, pl, current_frag, nfrags, power_dBm, which_mode,
+		pck = DataMPDU (ctx, msdu, pl, current_frag, nfrags, power_dBm, which_mode,
 				auxnav,apol,preambFlag);
 		if(BAAggFlag && TXOPflag) preambFlag = false;
 
@@ -1244,15 +1376,15 @@ void MAC_private::transmit() {
 			newnav = TXOPend;
 		} else if (current_frag == nfrags) { // If this is the last fragment:
 			newnav = ptr2sch->now() + rts_duration + cts_duration +
-					auxpck.get_duration() + ack_duration(which_mode) + 3*SIFS + 1;
+					auxpck.get_duration() + ack_duration(ctx, which_mode) + 3*SIFS + 1;
 		} else { // If there are other fragments after this one
 			newnav = ptr2sch->now() + rts_duration + cts_duration +
-					2*auxpck.get_duration() + 2*ack_duration(which_mode) +
+					2*auxpck.get_duration() + 2*ack_duration(ctx, which_mode) +
 					5*SIFS + 1;
 		}
 
 		ACKpolicy apol = (BAAggFlag && TXOPflag) ? blockACK:normalACK;
-		pck = DataMPDU (msdu, pl, current_frag, nfrags, power_dBm, which_mode,newnav,apol,preambFlag);
+		pck = DataMPDU (ctx, msdu, pl, current_frag, nfrags, power_dBm, which_mode,newnav,apol,preambFlag);
 		if(BAAggFlag && TXOPflag) preambFlag = false;
 
 		timestamp t = NAV + CTS_Timeout;
@@ -1267,15 +1399,16 @@ void MAC_private::transmit() {
 				<< ", NAV set to " << NAV << endl;
 
 		newnav = ptr2sch->now() + rts_duration + cts_duration +
-				auxpck.get_duration() + ack_duration(which_mode) +
+				auxpck.get_duration() + ack_duration(ctx, which_mode) +
 				3*SIFS + 1;
 
-		myphy->phyTxStartReq(MPDU(RTS,term,msdu.get_target(),power_dBm,MCS0,newnav),
+		myphy->phyTxStartReq(MPDU(ctx, RTS,term,msdu.get_target(),power_dBm,MCS0,newnav),
 				true);
 
 		countdown_flag = false;
 
-		ptr2sch->schedule(Event(t,(void*)&wrapper_to_cts_timed_out,(void*)this));
+		cts_timeout_event = ptr2sch->schedule(Event::callback<MAC_private,
+				&MAC_private::cts_timed_out>(t, this));
 	}
 
 	END_PROF("MAC::transmit")
@@ -1293,7 +1426,7 @@ unsigned MAC::macUnitdataReq(MSDU p) {
 		term->macUnitdataQueueOverflow(p);
 	} else {
 		accCat auxAC = term->get_connection_AC(p.get_target());
-		packet_queue[auxAC].push_back(p);
+		enqueue(auxAC, p);
 
 		if (get_queue_size() == 1 && time_to_wait_BA == timestamp(0)) new_msdu();
 	}
@@ -1337,17 +1470,20 @@ void MAC_private::tx_attempt() {
 					<< ", Channel is busy according to NAV (" << NAV
 					<< ")\n    reschedule tx attempt to " << NAV+1 << endl;
 
-			ptr2sch->schedule(Event(NAV+1,(void*)&wrapper_to_tx_attempt,(void*)this));
+			ptr2sch->schedule(Event::callback<MAC_private,
+					&MAC_private::tx_attempt>(NAV+1, this));
 
 			// verify if channel is busy
-		} else if (myphy->carrier_sensing()) {
+		} else if (contention ? contention->is_busy()
+		                      : myphy->carrier_sensing()) {
 
 			if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
 					<< " : transmission attempt, Channel is busy"
 					<< ", ask PHY to notify when it is free" << endl;
 
 			// if channel is busy, ask channel when it is free
-			myphy->notify_free_channel();
+			if (contention) contention->join(this);
+			else myphy->notify_free_channel();
 		} else {
 
 			if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
@@ -1360,20 +1496,6 @@ void MAC_private::tx_attempt() {
 	END_PROF("MAC::tx_attempt")
 }
 
-////////////////////////////////////////////////////////////////////////////////
-// MAC_private::get_queue_size												  //
-//                                                                            //
-// returns size of packet queue              							      //
-////////////////////////////////////////////////////////////////////////////////
-size_t MAC_private::get_queue_size()	{
-	size_t queSize = 0;
-	for(int k = 0; k < 5; k++){
-		accCat auxAC = allACs[k];
-		queSize = queSize + packet_queue[auxAC].size();
-	}
-	return queSize;
-}
-
 // Output operator << for accCat type
 ostream& operator<<(ostream& os, const accCat& AC) {
    switch(AC){
@@ -60,6 +60,9 @@ struct mac_struct {
 //                                                                            //
 //  The MAC object receives a packet through the function 'receive'.          //
 //                                                                            //
+//  If 'set_contention' is called, the backoff countdown is resolved by a     //
+//  Contention object, see "Contention.h".                                    //
+//                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 class MAC : MAC_private {
 
@@ -67,6 +70,7 @@ public:
   MAC(Terminal* t,    // pointer to owner terminal
       Scheduler* s,   // pointer to simulation scheduler
       random *r,      // pointer to random number generator
+      SimContext* x,  // pointer to simulation context
       log_file *l,    // pointer to log
       mac_struct mac // MAC layer parameters
      );
@@ -77,6 +81,9 @@ public:
 
   void connect (PHY* p) {myphy = p;}
   // associates PHY object '*p' to this object.
+
+  void set_contention (Contention* c) {contention = c;}
+  // backoff countdown is resolved by BSS '*c' instead of own events
   
   unsigned long get_n_packets_att() const {return n_att_frags;}
   // returns number of attempted data fragment transmissions
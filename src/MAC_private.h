@@ -32,6 +32,8 @@
 
 class PHY;
 class Terminal;
+class SimContext;
+class Contention;
 
 typedef enum{
 	AC_BK,
@@ -40,12 +42,54 @@ typedef enum{
 	AC_VO,
 	legacy
 }accCat;
-accCat const allACs[5] = {AC_BK, AC_BE, AC_VI, AC_VO, legacy};
+const int n_ACs = 5; // number of access categories
+accCat const allACs[n_ACs] = {AC_BK, AC_BE, AC_VI, AC_VO, legacy};
 
 ostream& operator << (ostream& os, const accCat& AC);
 string operator+= (string& s, const accCat& AC);
 // Overload of output operator for accCat types
 
+////////////////////////////////////////////////////////////////////////////////
+// class ac_queue                                                             //
+//                                                                            //
+// MSDU queue of one access category. MSDUs are kept in one FIFO sub-queue    //
+// per receiver, and receivers with queued MSDUs take turns in round-robin    //
+// order. 'front' is the oldest MSDU of the receiver whose turn it is, so the //
+// frames of a TXOP or an A-MPDU for that receiver are reached in O(1).       //
+////////////////////////////////////////////////////////////////////////////////
+class ac_queue {
+  vector<deque<MSDU> > sub; // sub-queues, one per receiver
+  vector<int> slot;         // index in 'sub' for each receiver id, -1 if none
+  deque<unsigned> turn;     // sub-queues with MSDUs, in round-robin order
+  size_t n;                 // number of MSDUs in all sub-queues
+
+  unsigned slot_of(Terminal* t);
+  // returns index of sub-queue of receiver 't', creating it if needed
+
+public:
+  ac_queue() : n(0) {}
+
+  size_t size() const {return n;}
+
+  const MSDU& front() const {return sub[turn.front()].front();}
+  // oldest MSDU of the receiver whose turn it is
+
+  const deque<MSDU>& front_receiver() const {return sub[turn.front()];}
+  // all MSDUs of the receiver whose turn it is, in transmission order
+
+  void push_back(const MSDU& p);
+  // appends new MSDU to the sub-queue of its receiver
+
+  void push_front(const MSDU& p);
+  // reinserts MSDU for retransmission ahead of its receiver's other MSDUs
+
+  void pop_front(bool next);
+  // removes 'front()'. If 'next', the turn passes to the following receiver
+
+  void next_receiver();
+  // passes the turn to the following receiver
+};
+
 typedef enum {
 	success,
 	ACKfail,
@@ -58,21 +102,35 @@ typedef enum {
 // declares private member objects and functions of class MAC                 //
 ////////////////////////////////////////////////////////////////////////////////
 class MAC_private {
+  friend class Contention;
+
 protected:
   Scheduler* ptr2sch;  // pointer to simulation scheduler
   random*    randgen;  // pointer to random number generator
+  SimContext* ctx;     // pointer to simulation context
 
-  map< accCat,deque<MSDU> > packet_queue;
-  map<accCat,unsigned> CW_ACs;	 // Contention window of all ACs
-  map<accCat,unsigned> BOC_ACs;  // Backoff Counter (BOC) of front packets of ACs queues
-  map<accCat,bool> BOC_flag; 	 // Flag that defines if the BOC has to be recalculated to
+  // per-AC state, indexed by accCat
+  ac_queue packet_queue[n_ACs];
+  unsigned CW_ACs[n_ACs];	 // Contention window of all ACs
+  unsigned BOC_ACs[n_ACs];  // Backoff Counter (BOC) of front packets of ACs queues
+  bool BOC_flag[n_ACs]; 	 // Flag that defines if the BOC has to be recalculated to
   	  	  	  	  	  	  	 	 // an AC
+  size_t queue_size;         // number of MSDUs in all AC queues
+
+  void enqueue(accCat AC, const MSDU& p) {
+    packet_queue[AC].push_back(p); ++queue_size;}
+  void requeue(accCat AC, const MSDU& p) {
+    packet_queue[AC].push_front(p); ++queue_size;}
+  void dequeue(accCat AC) {packet_queue[AC].pop_front(!TXOPflag); --queue_size;}
+  // insert and remove MSDUs, keeping track of 'queue_size'. Outside a TXOP
+  // the next MSDU is taken from the following receiver
 
   log_file*  mylog;
   bool       logflag;  // true if MAC events should be logged
   
   PHY* myphy;      // pointer to physical layer
   Terminal* term;  // pointer to owner terminal
+  Contention* contention; // analytic backoff of the BSS, 0 if event-driven
 
   transmission_mode mode;  // transmission rate of current fragment train
 
@@ -128,6 +186,13 @@ protected:
   timestamp rts_duration;
   timestamp CTS_Timeout;
 
+  // handles of scheduled events that may be cancelled
+  event_handle start_TXOP_event;
+  event_handle end_TXOP_event;
+  event_handle ack_timeout_event;
+  event_handle cts_timeout_event;
+  event_handle ba_timeout_event;
+
   void set_myAC(accCat AC);
 
   void ack_timed_out();
@@ -136,6 +201,13 @@ protected:
 
   void begin_countdown();
 
+  void freeze_backoff();
+  // channel became busy, stop countdown and cancel transmission
+
+  void resume_backoff();
+  // channel became free, resume countdown after NAV and AIFS (only used by
+  // analytic backoff)
+
   void check_nav();
   // check if channel is free despite NAV (when RTS was detected)
 
@@ -159,7 +231,10 @@ protected:
   void send_data();
   
   void aggreg_send();
-  // define aggregation steps
+  // transmit A-MPDU beginning with 'pck'
+
+  void aggreg_end();
+  // A-MPDU was transmitted, wait for BA
 
   void start_TXOP();
   // start TXOP time counting
@@ -181,54 +256,8 @@ protected:
     
 public:
   
-  size_t get_queue_size();
+  size_t get_queue_size() const {return queue_size;}
   // returns size of complete packet queue
-
-  /////////////////////////////////////////////////////
-  // wrapper functions for member-function call-back //
-  /////////////////////////////////////////////////////
-  static void wrapper_to_ack_timed_out (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->ack_timed_out();}
-
-  static void wrapper_to_ba_timed_out (void* ptr2obj) {
-      ((MAC_private*)ptr2obj)->ba_timed_out();}
-
-  static void wrapper_to_check_nav (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->check_nav();}
-
-  static void wrapper_to_cts_timed_out (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->cts_timed_out();}
-
-  static void wrapper_to_end_nav (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->end_nav();}
-
-  static void wrapper_to_end_TXOP (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->end_TXOP();}
-
-  static void wrapper_to_start_TXOP (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->start_TXOP();}
-
-  static void wrapper_to_aggreg_send (void* ptr2obj) {
-      ((MAC_private*)ptr2obj)->aggreg_send();}
-
-  static void wrapper_to_send_ack (void* ptr2obj, void* param) {
-    ((MAC_private*)ptr2obj)->send_ack((Terminal*)param);}
-
-  static void wrapper_to_send_cts (void* ptr2obj, void* param) {
-    ((MAC_private*)ptr2obj)->send_cts((Terminal*)param);}
-
-  static void wrapper_to_send_ba (void* ptr2obj, void* param) {
-    ((MAC_private*)ptr2obj)->send_ba((Terminal*)param);}
-
-  static void wrapper_to_send_data (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->send_data();}
-    
-  static void wrapper_to_transmit (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->transmit();}
-
-  static void wrapper_to_tx_attempt (void* ptr2obj) {
-    ((MAC_private*)ptr2obj)->tx_attempt();}    
-  /////////////////////////////////////////////////////
 };
 
 #endif
@@ -24,7 +24,7 @@
 #include "Channel.h"
 #include "PHY.h"
 #include "Profiler.h"
-#include "Standard.h"
+#include "SimContext.h"
 
 #include <math.h>
 
@@ -37,8 +37,6 @@ const double burst_length = 3.3;
 //                                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
-unsigned PHY_private::nphys = 0;
-
 ////////////////////////////////////////////////////////////////////////////////
 // PHY constructor                                                            //
 ////////////////////////////////////////////////////////////////////////////////
@@ -47,6 +45,7 @@ PHY::PHY(Terminal* t,
          Channel* c,
          random* r,
          Scheduler* s,
+         SimContext* x,
          log_file* l,
          PHY_struct ps) {
 
@@ -55,14 +54,15 @@ PHY::PHY(Terminal* t,
     ch = c;
     rand_gen = r;
     ptr2sch = s;
+    ctx = x;
     mylog = l;
     logflag = (*mylog)(log_type::phy);
     
-    NoiseVariance_dBm = ps.NoiseDen + to_dB(Standard::get_band_double());
+    NoiseVariance_dBm = ps.NoiseDen + to_dB(ctx->standard.get_band_double());
     CCASensitivity_dBm = ps.Sens;
 
     busy_begin = busy_end = timestamp(0);
-    id = nphys++;
+    id = ctx->nphys++;
     
     energy = 0;
 }
@@ -72,48 +72,20 @@ PHY::PHY(Terminal* t,
 //                                                                            //
 // returns packet error rate for a given transmission rate and sinal-to-noise //
 // ratio 'SNR' dB. The pack error rate is calculated based on a polynomial    //
-// approximation of the function log10(PER) x SNR.                            //
-// Depending on the SNR, one of three different polynomials is used.          //
+// approximation of the function log10(PER) x SNR, or interpolated from a     //
+// table of this function (see Standard::get_per).                            //
 ////////////////////////////////////////////////////////////////////////////////
 double PHY_private::calculate_per(transmission_mode mode, double SNR) const {
 BEGIN_PROF("PHY::calculate_per")
 
-  double per;
-
   unsigned index = mode - MCS0;
 
-  if (SNR < Standard::get_min_thresh(index)) {
-    // if SNR is low, then consider BER = 0.5
-    per = 1;
-
-  } else if (SNR > Standard::get_max_thresh(index)) {
-
-    // if SNR is high then use polynomial of order 'n_coeff_high - 1'
-    double perlog = 0;
-
-    double auxpow = 1.0;
-    for (int i = 0; i < n_coeff_high; i++) {
-      perlog += auxpow * Standard::get_coeff_high(index,i);
-      auxpow = auxpow * SNR;
-    }
-    per = pow(10.0,perlog);
-
-  } else {
-
-	  if (logflag) *mylog << "\n!!!!!" << ptr2sch->now() << "sec., " << *term << ": "
+  if (logflag && SNR >= ctx->standard.get_min_thresh(index)
+      && SNR <= ctx->standard.get_max_thresh(index))
+	  *mylog << "\n!!!!!" << ptr2sch->now() << "sec., " << *term << ": "
 			  << "using oder 4 polynomial." << endl;
 
-    // if SNR is medium then use polynomial of order 'n_coeff - 1'
-    double perlog = 0;
-
-    double auxpow = 1.0;
-    for (int i = 0; i < n_coeff; i++) {
-      perlog += auxpow * Standard::get_coeff(index,i);
-      auxpow = auxpow * SNR;
-    }
-    per = pow(10.0,perlog);
-  }
-  if(per > 1.0) per = 1.0; // Polynomial approximations might hand out a PER greated than one
+  double per = ctx->standard.get_per(index, SNR);
 
 END_PROF("PHY::calculate_per")
 return per;
@@ -122,18 +94,23 @@ return per;
 ////////////////////////////////////////////////////////////////////////////////
 // PHY_private::calculate_SNReff                                              //
 //                                                                            //
-// returns effective SNR for given subcarriers SNRs (SNRps), calculated using //
-// the exponential method and beta parameter given.							  //
+// returns effective SNR in dB for the 'n' linear subcarrier SNRs in 'SNRps', //
+// calculated using the exponential method and beta parameter given.          //
+// 'SNRps' is overwritten.                                                    //
 ////////////////////////////////////////////////////////////////////////////////
-double PHY_private::calculate_SNReff(valarray<double> SNRps, double beta) const {
+double PHY_private::calculate_SNReff(double* SNRps, unsigned n,
+                                     double beta) const {
 	BEGIN_PROF("PHY::calculate_SNReff")
 
-	unsigned Np = Standard::get_numSubcarriers();
+	unsigned Np = ctx->standard.get_numSubcarriers();
 
-	valarray<double> auxVal = from_dB(SNRps);
-	auxVal = exp(-auxVal/beta);
+	// exp(-SNR/beta) = 2^(-SNR*log2(e)/beta)
+	double scale = -M_LOG2E/beta;
+	for (unsigned k = 0; k < n; k++) SNRps[k] *= scale;
+	exp2_array(SNRps, SNRps, n);
 
-	double SNReff = auxVal.sum();
+	double SNReff = 0;
+	for (unsigned k = 0; k < n; k++) SNReff += SNRps[k];
 	SNReff = SNReff/(double)Np;
 	SNReff = to_dB(-beta*log(SNReff));
 
@@ -243,22 +220,11 @@ transmission_mode PHY::opt_mode(Terminal* t1, unsigned pack_len,
                                 double per_target, double power) {
 BEGIN_PROF("PHY::opt_mode")
 
-  transmission_mode mode = Standard::get_maxMCS();
-  unsigned nbits = (DataMPDU(pack_len)).get_nbits();
+  unsigned nbits = (DataMPDU(ctx, pack_len)).get_nbits();
   double SNR = power - ch->get_path_loss(t1->get_phy(), this)
                      - NoiseVariance_dBm;
 
-  for(;;) {
-    if (mode == MCS0) break;
-
-    double per = calculate_per(mode, SNR);
-
-    if (per <= per_target) break;
-    else --mode;
-
-  }
-
-  return mode;
+  return ctx->standard.opt_mcs(SNR, per_target);
 END_PROF("PHY::opt_mode")  
 }
 
@@ -274,7 +240,7 @@ double PHY::opt_power(Terminal* t1, unsigned pack_len, double per_target,
                       double pstep) {
 BEGIN_PROF("PHY::opt_power")
   double power = pmin;
-  unsigned nbits = (DataMPDU(pack_len)).get_nbits();
+  unsigned nbits = (DataMPDU(ctx, pack_len)).get_nbits();
 
   double att = ch->get_path_loss(t1->get_phy(), this) + NoiseVariance_dBm;
   
@@ -283,9 +249,7 @@ BEGIN_PROF("PHY::opt_power")
   
     if (power >= pmax) break;
 
-    double per = calculate_per(mode, SNR);
-
-    if (per <= per_target) break;
+    if (ctx->standard.per_below(mode - MCS0, SNR, per_target)) break;
     else power += pstep;
 
   }
@@ -297,18 +261,30 @@ END_PROF("PHY::opt_mode")
 ////////////////////////////////////////////////////////////////////////////////
 // PHY::receive                                                               //
 //                                                                            //
-// a packet 'p' is received with path loss 'path_loss' dB and interference    //
-// level 'interf' mW. If packet is received correctly, forward it to MAC      //
-// layer.                                                                     //
+// a packet 'p' is received with subcarrier path losses 'path_loss' dB and    //
+// subcarrier interference levels 'interf' mW. The SNIR of each subcarrier    //
+// considers the interference at this subcarrier. If packet is received       //
+// correctly, forward it to MAC layer.                                        //
 ////////////////////////////////////////////////////////////////////////////////
-void PHY::receive(MPDU pck, valarray<double> path_loss, double interf) {
+void PHY::receive(MPDU pck, const valarray<double>& path_loss,
+                  const valarray<double>& interf) {
 BEGIN_PROF("PHY::receive")
 
-  double Np = (double)Standard::get_numSubcarriers();
-  valarray<double> rx_sub = (pck.get_power() - to_dB(Np)) - path_loss;
+  double Np = (double)ctx->standard.get_numSubcarriers();
+  unsigned n = path_loss.size();
+  if (rx_sub.size() < n) {
+    rx_sub.resize(n);
+    SNIRps.resize(n);
+  }
 
-  valarray<double> auxVal = from_dB(rx_sub);
-  double rx_pow = to_dB(auxVal.sum());
+  // received power per subcarrier in mW, 'SNIRps' holds exponents of 2
+  double p_sub = (pck.get_power() - to_dB(Np)) * dB_to_log2;
+  for (unsigned k = 0; k < n; k++) SNIRps[k] = p_sub - path_loss[k]*dB_to_log2;
+  exp2_array(&SNIRps[0], &rx_sub[0], n);
+
+  double rx_pow = 0;
+  for (unsigned k = 0; k < n; k++) rx_pow += rx_sub[k];
+  rx_pow = to_dB(rx_pow);
 
   if (rx_pow < CCASensitivity_dBm) {
 
@@ -335,17 +311,37 @@ BEGIN_PROF("PHY::receive")
     busy_end = now;
     busy_begin = now - duration;
 
-    double NoiseInterfVar = (interf>0)? 10.0*log10(interf +
-                                             pow(10.0,NoiseVariance_dBm/10.0))
-                                      : NoiseVariance_dBm;
-
-    valarray<double> SNIRps = rx_sub - (NoiseInterfVar - to_dB(Np));
+    // noise and interference are added at each subcarrier
+    double noise_sub = from_dB(NoiseVariance_dBm) / Np;
+    if (interf.size() && interf.max() > 0) {
+      for (unsigned k = 0; k < n; k++)
+        SNIRps[k] = rx_sub[k] / (interf[k] + noise_sub);
+    } else for (unsigned k = 0; k < n; k++) SNIRps[k] = rx_sub[k] / noise_sub;
 
-    double SNIReff = calculate_SNReff(SNIRps,Standard::get_beta(pck.get_mode(),ch->get_channel_model()));
+    double SNIReff = calculate_SNReff(&SNIRps[0], n,
+             ctx->standard.get_beta(pck.get_mode(),ch->get_channel_model()));
 
     double pack_error_prob = calculate_per(pck.get_mode(), SNIReff);
 
-    if (rand_gen->uniform() > pack_error_prob) {
+    if (pck.get_subframes().size()) {
+      // A-MPDU: each subframe is lost independently with the same PER
+      const vector<long_integer>& sub = pck.get_subframes();
+      rx_subframes.clear();
+      for (unsigned k = 0; k < sub.size(); k++)
+        if (rand_gen->uniform() > pack_error_prob)
+          rx_subframes.push_back(sub[k]);
+
+      if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term
+                          << " (PHY) : SNIReff = " << SNIReff << "dB, PER = "
+                          << pack_error_prob << ", " << pck << ", "
+                          << rx_subframes.size() << " subframes received"
+                          << endl;
+
+      if (rx_subframes.size()) {
+        pck.set_subframes(rx_subframes);
+        mymac->phyRxEndInd(pck);
+      }
+    } else if (rand_gen->uniform() > pack_error_prob) {
 
       if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *term 
                           << " (PHY) : SNIReff = " << SNIReff << "dB, PER = "
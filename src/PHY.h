@@ -63,6 +63,9 @@ struct PHY_struct {
 //    PER = 1 - pow((1-BER/L),N),                                             //
 //  where N is the number of bits in a packet and L is the expected error     //
 //  burst length, which is employed to approximate the coding effects.        //
+//  The subframes of an A-MPDU share the SNIR of their PPDU, but each one is  //
+//  lost independently with this PER. Only the subframes received correctly   //
+//  are forwarded to the MAC layer.                                           //
 //                                                                            //
 //  Functions 'carrier_sensing', 'notify_busy_channel', 'notify_free_channel' //
 //  'cancel_notify_busy_channel', 'cancel_notify_free_channel' can be used    //
@@ -82,6 +85,7 @@ public:
       Channel* c,   // pointer to wireless channel used
       random* r,    // pointer to random number generator
       Scheduler* s, // pointer to simulation scheduler
+      SimContext* x, // pointer to simulation context
       log_file* l,  // pointer to log
       PHY_struct ps // struct with physical layer parameters
       );
@@ -113,9 +117,11 @@ public:
   void cancel_notify_free_channel();
   // MAC cancels notification request.
 
-  void receive(MPDU p, valarray<double> path_loss, double interf = 0);
-  // a packet 'p' is received with path loss 'path_loss' dB and interference level
-  // 'interf' mW. If packet is received correctly, forward it to MAC layer.
+  void receive(MPDU p, const valarray<double>& path_loss,
+               const valarray<double>& interf = valarray<double>());
+  // a packet 'p' is received with subcarrier path losses 'path_loss' dB and
+  // subcarrier interference levels 'interf' mW (none if empty). If packet is
+  // received correctly, forward it to MAC layer.
 
   void phyTxStartReq(MPDU p, bool to_all);
   // send packet 'p' to wireless channel. If 'to_all' is true, then packet will
@@ -29,11 +29,13 @@
 #include "Position.h"
 #include "log.h"
 #include <valarray>
+#include <vector>
 #include <cmath>
 
 class Terminal;
 class MAC;
 class Channel;
+class SimContext;
 
 ////////////////////////////////////////////////////////////////////////////////
 // class PHY_private                                                          //
@@ -47,14 +49,14 @@ protected:
   Scheduler* ptr2sch; // pointer to simulation scheduler
   random* rand_gen;   // pointer to random number generator
   Channel* ch;        // pointer to wireless channel
+  SimContext* ctx;    // pointer to simulation context
 
   log_file*  mylog;
   bool       logflag;
 
   Position pos;       // transceiver location
 
-  static unsigned nphys; // number of instanced PHYs
-  unsigned id;           // unique identification number
+  unsigned id;        // unique identification number
 
   double NoiseVariance_dBm;
   double CCASensitivity_dBm; // carrier sensitivity level
@@ -70,9 +72,17 @@ protected:
   // ratio 'SNR' dB. The packet error rate is calculated based on a polynomial
   // approximation of the function log10(PER) x SNR.
 
-  double calculate_SNReff(valarray<double> SNRps, double beta) const;
-  // returns Effective SNR SNReff of subcarriers SNRs SNRps, calculated using
-  // the exponential method with given beta parameter
+  vector<double> rx_sub, SNIRps;
+  // scratch storage for the received power and SNIR of each subcarrier in
+  // linear scale, so that packet reception does not allocate memory
+
+  vector<long_integer> rx_subframes;
+  // scratch storage for the correctly received subframes of an A-MPDU
+
+  double calculate_SNReff(double* SNRps, unsigned n, double beta) const;
+  // returns Effective SNR SNReff in dB of 'n' linear subcarrier SNRs SNRps,
+  // calculated using the exponential method with given beta parameter.
+  // SNRps is overwritten.
 
 };
 
@@ -25,8 +25,9 @@
 
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 
-#include "Standard.h"
+#include "SimContext.h"
 #include "Terminal.h"
 
 //////////////////////
@@ -56,11 +57,16 @@ const unsigned coding_overhead = 6; // number of termination bits
 // output operator << //
 ////////////////////////
 ostream& operator<< (ostream& os, const transmission_mode& tm) {
-  unsigned w = os.width() - 5;
+  // data rate depends on the simulated standard, see Standard::tx_mode_to_double
   switch(tm) {
     case OPT: return os << "OPT";
     case SUBOPT: return os << "SUBOPT";
-    default: return os << setw(w) << Standard::tx_mode_to_double(tm) << " Mbps";
+    case MCS: return os << "MCS";
+    default: {
+      ostringstream str;
+      str << "MCS" << tm - MCS0;
+      return os << str.str();
+    }
   }
 }
 
@@ -95,16 +101,17 @@ istream& operator>> (istream& is, transmission_mode& tm) {
 //
 // calculates the packet duration                                             //
 ////////////////////////////////////////////////////////////////////////////////
-timestamp calc_duration (unsigned nbits, transmission_mode mode, bool addPre) {
+timestamp calc_duration (unsigned nbits, transmission_mode mode, bool addPre,
+                         const Standard& st) {
 
   unsigned bits_per_symbol;
 
-  if(mode == MCS || mode > Standard::get_maxMCS()){
+  if(mode == MCS || mode > st.get_maxMCS()){
 	  cout << "In the if" << endl;
-	  cout << "Standard: " << Standard::get_standard() << endl;
+	  cout << "Standard: " << st.get_standard() << endl;
 	  return timestamp(0);
   }
-  bits_per_symbol = Standard::txMode_bits_per_symbol(mode);
+  bits_per_symbol = st.txMode_bits_per_symbol(mode);
 
   // calculate number of OFDM symbols in payload
   // consider termination bits
@@ -115,7 +122,7 @@ timestamp calc_duration (unsigned nbits, transmission_mode mode, bool addPre) {
   if(addPre) nsymbols += phy_overhead;
 
   // calculate time
-  return timestamp(double(nsymbols) * Standard::get_symbol_period());
+  return timestamp(double(nsymbols) * st.get_symbol_period());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -123,14 +130,21 @@ timestamp calc_duration (unsigned nbits, transmission_mode mode, bool addPre) {
 // class Packet                                                               //
 ////////////////////////////////////////////////////////////////////////////////
 
-long_integer Packet::packet_count = 0;
+////////////////////////////////////////////////////////////////////////////////
+// Packet Constructor                                                         //
+////////////////////////////////////////////////////////////////////////////////
+Packet::Packet(SimContext* c) {
+  id = c->packet_count++;
+  source = 0;
+  target = 0;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 // MSDU Constructor                                                           //
 ////////////////////////////////////////////////////////////////////////////////
-MSDU::MSDU(unsigned n, Terminal* from , Terminal* to, unsigned priority,
-           timestamp gen_time)
-           : nbytes_data(n), tid(priority), time_created(gen_time) {
+MSDU::MSDU(SimContext* c, unsigned n, Terminal* from , Terminal* to,
+           unsigned priority, timestamp gen_time)
+           : Packet(c), nbytes_data(n), tid(priority), time_created(gen_time) {
 
   retry_count = 0;
   source = from;
@@ -140,9 +154,9 @@ MSDU::MSDU(unsigned n, Terminal* from , Terminal* to, unsigned priority,
 ////////////////////////////////////////////////////////////////////////////////
 // MPDU Constructor                                                           //
 ////////////////////////////////////////////////////////////////////////////////
-MPDU::MPDU(packet_type tp, Terminal* from, Terminal* to, double p,
-           transmission_mode r, timestamp nav)
-           :  mode(r), t(tp), tx_power(p), net_all_vec(nav) {
+MPDU::MPDU(SimContext* c, packet_type tp, Terminal* from, Terminal* to,
+           double p, transmission_mode r, timestamp nav)
+           :  Packet(c), mode(r), t(tp), tx_power(p), net_all_vec(nav) {
 
   source = from;
   target = to;
@@ -170,7 +184,7 @@ MPDU::MPDU(packet_type tp, Terminal* from, Terminal* to, double p,
   ACKpol = noACK;
 
   nbits = nbytes_overhead*8;
-  packet_duration = calc_duration (nbits, mode, true);
+  packet_duration = calc_duration (nbits, mode, true, c->standard);
 
   pcks2ACK.clear();
 }
@@ -189,14 +203,27 @@ void MPDU::setPcks2Ack(const vector<long_integer>& pcks2Ack) {
 	pcks2ACK = pcks2Ack;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// MPDU make_ampdu                                                            //
+//                                                                            //
+// An A-MPDU is transmitted as a single PPDU. It keeps the header fields of   //
+// its first subframe.                                                        //
+////////////////////////////////////////////////////////////////////////////////
+void MPDU::make_ampdu(const vector<long_integer>& ids, timestamp d) {
+	if (t != DATA || ACKpol != blockACK) throw(my_exception(GENERAL,
+			"Attempt to aggregate packet without block ACK policy"));
+	subframes = ids;
+	packet_duration = d;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // DataMPDU Constructors                                                      //
 ////////////////////////////////////////////////////////////////////////////////
-DataMPDU::DataMPDU (unsigned n, Terminal* from, Terminal* to, double p, 
-                    transmission_mode r, timestamp nav, unsigned priority,
-                    unsigned frag, unsigned nfrags,unsigned mid, ACKpolicy apol,
-					bool addP)
-                    : tid(priority), frag_number(frag),
+DataMPDU::DataMPDU (SimContext* c, unsigned n, Terminal* from, Terminal* to,
+                    double p, transmission_mode r, timestamp nav,
+                    unsigned priority, unsigned frag, unsigned nfrags,
+                    unsigned mid, ACKpolicy apol, bool addP)
+                    : MPDU(c), tid(priority), frag_number(frag),
                       frag_total(nfrags), msdu_id(mid), nbytes_data(n){
 
   t = DATA;
@@ -214,13 +241,14 @@ DataMPDU::DataMPDU (unsigned n, Terminal* from, Terminal* to, double p,
           "Normal ACK packet without preamble."));
 
   nbits = (nbytes_data + nbytes_overhead)*8;
-  packet_duration = calc_duration (nbits, mode, addP);
+  packet_duration = calc_duration (nbits, mode, addP, c->standard);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-DataMPDU::DataMPDU (MSDU pck, int n, unsigned frag, unsigned nfrags, double p,
-                    transmission_mode r, timestamp nav, ACKpolicy apol, bool addP)
-                    : frag_number(frag), frag_total(nfrags){
+DataMPDU::DataMPDU (SimContext* c, MSDU pck, int n, unsigned frag,
+                    unsigned nfrags, double p, transmission_mode r, timestamp nav,
+                    ACKpolicy apol, bool addP)
+                    : MPDU(c), frag_number(frag), frag_total(nfrags){
 
   t = DATA;
   nbytes_data = (n >= 0)? n : pck.get_nbytes();
@@ -237,7 +265,7 @@ DataMPDU::DataMPDU (MSDU pck, int n, unsigned frag, unsigned nfrags, double p,
   if(ACKpol == blockACK) nbytes_overhead += mpdu_delimiter_overhead;
 
   nbits = (nbytes_data + nbytes_overhead)*8;
-  packet_duration = calc_duration (nbits, mode, addP);
+  packet_duration = calc_duration (nbits, mode, addP, c->standard);
 
 }
 
@@ -247,6 +275,9 @@ DataMPDU::DataMPDU (MSDU pck, int n, unsigned frag, unsigned nfrags, double p,
 ostream& operator << (ostream& os, const MPDU& p) {
   switch (p.t) {
     case DATA:
+      if (p.subframes.size())
+        return os << "A-MPDU " << p.id << " with " << p.subframes.size()
+                  << " subframes from " << *(p.source) << " to " << *(p.target);
       return os << "data packet " << p.id << " from " << *(p.source) << " to " 
                 << *(p.target);
     case ACK:
@@ -28,7 +28,7 @@
 #include <vector>
 
 class Terminal;
-class Standard;
+class SimContext;
 
 ////////////////////////////////////////////////////////////////////////////////
 // enum transmission_mode                                                     //
@@ -81,14 +81,17 @@ protected:
   Terminal* source; // source terminal
   Terminal* target; // target terminal
 
-  static long_integer packet_count;
   long_integer id;
 
   Packet() {
-	  id = packet_count++;
+	  id = not_a_long_integer;
 	  source = 0;
 	  target = 0;
   }
+  // empty packet, e.g., as placeholder in containers
+
+  Packet(SimContext* c);
+  // new packet, numbered by simulation context '*c'
 
 public:
   long_integer      get_id ()        const {return id;}
@@ -108,7 +111,10 @@ class MSDU : public Packet {
 	timestamp tx_time;
 
 public:
-	MSDU(unsigned n = 0,            // number of data bytes
+	MSDU() : nbytes_data(0), tid(0), time_created(0), retry_count(0) {}
+
+	MSDU(SimContext* c,             // simulation context
+			unsigned n,                // number of data bytes
 			Terminal* from = 0,        // source terminal
 			Terminal* to = 0,          // target terminal
 			unsigned priority = 0,     // traffic identifier
@@ -145,8 +151,17 @@ protected:
   vector<long_integer> pcks2ACK;
   ACKpolicy ACKpol;
 
+  // Used only for A-MPDUs, identification numbers of the aggregated MPDUs
+  vector<long_integer> subframes;
+
+  MPDU(SimContext* c) : Packet(c), mode(MCS), t(DUMMY), tx_power(0) {}
+  // numbered packet, fields are set by derived class
+
 public:
-  MPDU(packet_type tp = DUMMY,    // packet type
+  MPDU() : mode(MCS), t(DUMMY), tx_power(0), ACKpol(noACK) {}
+
+  MPDU(SimContext* c,             // simulation context
+       packet_type tp,            // packet type
        Terminal* from = 0,        // source terminal
        Terminal* to = 0,          // target terminal
        double p = 0,              // transmit power in dBm
@@ -162,6 +177,7 @@ public:
   packet_type       get_type()       const {return t;}
   ACKpolicy			get_ACKpol()	 const {return ACKpol;}
   vector<long_integer> getPcks2Ack() const {return pcks2ACK;}
+  const vector<long_integer>& get_subframes() const {return subframes;}
 
   friend ostream& operator << (ostream& os, const MPDU& p);
   friend ostream& operator << (ostream& os, const vector<long_integer>& vec);
@@ -171,6 +187,13 @@ public:
   void setACKpol(ACKpolicy acKpol) {
 	  ACKpol = acKpol;
   }
+
+  void make_ampdu(const vector<long_integer>& ids, timestamp d);
+  // turns this data packet into an A-MPDU with total duration 'd', which
+  // aggregates the MPDUs with identification numbers 'ids'
+
+  void set_subframes(const vector<long_integer>& ids) {subframes = ids;}
+  // keeps only the subframes 'ids' of an A-MPDU, e.g., those received
 };
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -184,7 +207,8 @@ class DataMPDU : public MPDU {
   unsigned nbytes_data;     // number of data bytes
 
 public:
-  DataMPDU (unsigned n,            // number of data bytes  
+  DataMPDU (SimContext* c,         // simulation context
+            unsigned n,            // number of data bytes  
             Terminal* from = 0,
             Terminal* to = 0,
             double p = 0,
@@ -198,7 +222,8 @@ public:
 			bool addP = true
            );
 
-  DataMPDU (MSDU pck,
+  DataMPDU (SimContext* c,
+            MSDU pck,
             int n = -1,
             unsigned frag = 1,
             unsigned nfrags = 1,                     
@@ -219,10 +244,10 @@ public:
 };
 
 ////////////////////////////////////////////////////////////////////////////////
-inline timestamp ack_duration(transmission_mode tm) {
-  return (MPDU(ACK, 0, 0, 0, tm)).get_duration();
+inline timestamp ack_duration(SimContext* c, transmission_mode tm) {
+  return (MPDU(c, ACK, 0, 0, 0, tm)).get_duration();
 }
-inline timestamp ba_duration(transmission_mode tm) {
-  return (MPDU(BA, 0, 0, 0, tm)).get_duration();
+inline timestamp ba_duration(SimContext* c, transmission_mode tm) {
+  return (MPDU(c, BA, 0, 0, 0, tm)).get_duration();
 }
 #endif
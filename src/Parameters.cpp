@@ -163,6 +163,11 @@ bool Parameters::assign (string s1,string s2) {
     which_param = &APPosition[index];
     if (!APPosition[index].read_vec(s2)) return false;
 
+  } else if (!s1.compare("Backoff")) {
+    istringstream is(s2);
+    is >> Backoff;
+    if (is.fail()) return false;
+
   } else if (!s1.compare("CCASensitivity_dBm")){
     which_param = &CCASensitivity_dBm;
     if (!CCASensitivity_dBm.read_vec(s2)) return false;
@@ -182,11 +187,23 @@ bool Parameters::assign (string s1,string s2) {
     which_param = &DownlinkFactor;
     if (!DownlinkFactor.read_vec(s2,bind2nd(less<double>(),0))) return false;
 
+  } else if (!s1.compare("EventQueue")) {
+    istringstream is(s2);
+    is >> EventQueue;
+    if (is.fail()) return false;
+
+  } else if (!s1.compare("FadingTrace")) {
+    FadingTrace = s2;
+
   } else if (!s1.compare("FragmentationThreshold")){
     which_param = &FragmentationThresh;
     if (!FragmentationThresh.read_vec(s2,bind2nd(less_equal<unsigned>(),0)))
       return false;
 
+  } else if (!s1.compare("InterferenceFading")){
+    which_param = &InterferenceFading;
+    if (!InterferenceFading.read_vec(s2)) return false;
+
   } else if (!s1.compare("LAFailLimit")){
     which_param = &LAFailLimit;
     if (!LAFailLimit.read_vec(s2,bind2nd(less_equal<unsigned>(),0)))
@@ -241,6 +258,10 @@ bool Parameters::assign (string s1,string s2) {
     which_param = &PacketLength;
     if (!PacketLength.read_vec(s2)) return false;
 
+  } else if (!s1.compare("PERTable")){
+    which_param = &PERTable;
+    if (!PERTable.read_vec(s2)) return false;
+
   } else if (!s1.compare("QueueSize")){
     which_param = &QueueSize;
     if (!QueueSize.read_vec(s2)) return false;
@@ -272,6 +293,11 @@ bool Parameters::assign (string s1,string s2) {
   } else if (!s1.compare("TempOutputInterval")){
     TempOutputInterval = timestamp(atof(s2.c_str()));
 
+  } else if (!s1.compare("Threads")) {
+    int n = atoi(s2.c_str());
+    if (n < 0) return false;
+    Threads = n;
+
   } else if (!s1.compare("TransientTime")) {
     TransientTime = timestamp(atof(s2.c_str()));
 
@@ -372,6 +398,10 @@ void Parameters::default_config () {
   MaxSimTime = timestamp(0);
   Confidence = .95;
   TransientTime = timestamp(0);
+  Threads = 1;
+  EventQueue = HEAP;
+  Backoff = EVENT_DRIVEN;
+  FadingTrace = "";
   Seed.init("seed",1);
 
 
@@ -394,6 +424,7 @@ void Parameters::default_config () {
   DopplerSpread_Hz.init("Doppler spread",0,"Hz");
   NumberSinus.init("Number of sinusoidals",20);
   ChannelModel.init("Channel Multipath Model",A);
+  InterferenceFading.init("fading of interference links",false);
 
   // PHY parameters
   TxPowerMax_dBm.init("maximum transmit power",0,"dBm");
@@ -404,6 +435,7 @@ void Parameters::default_config () {
   AdaptMode.init("adaptation mode",RATE);
   Bandwidth.init("bandwidth",MHz20);
   shortGI.init("Guard Interval",false);
+  PERTable.init("PER lookup table",true);
 
   TargetPER.init("target PER",.1);
 
@@ -446,6 +478,19 @@ Position Parameters::get_APPosition(unsigned which_ap) {
   }
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Parameters::get_number_of_iterations                                       //
+//                                                                            //
+// returns number of parameter combinations (including seeds)                 //
+////////////////////////////////////////////////////////////////////////////////
+unsigned Parameters::get_number_of_iterations() {
+  unsigned n = Seed.size();
+  for (vector<param_vec*>::const_iterator it = it_priority.begin();
+       it != it_priority.end(); it++) n *= (*it)->size();
+
+  return n;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Parameters::is_consistent                                                  //
 //                                                                            //
@@ -556,6 +601,16 @@ void Parameters::reset_iterations() {
        it != it_priority.end(); it++) (*it)->reset();
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Parameters::set_iteration                                                  //
+//                                                                            //
+// go to iteration number 'n' (first iteration is 0)                          //
+////////////////////////////////////////////////////////////////////////////////
+void Parameters::set_iteration(unsigned n) {
+  reset_iterations();
+  while (n-- > 0) new_iteration();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // output operator<<                                                          //
 ////////////////////////////////////////////////////////////////////////////////
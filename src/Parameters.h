@@ -32,6 +32,7 @@
 #include <iostream>
 
 #include "Scheduler.h"
+#include "Contention.h"
 #include "timestamp.h"
 #include "mypaths.h"
 #include "Terminal.h"
@@ -170,6 +171,10 @@ class Parameters {
   param_vec_bool partResults;
   double Confidence; // for calculation of confidence interval
   timestamp TransientTime; // transient time to be ignored
+  unsigned Threads; // number of iterations simulated in parallel (0 = all cores)
+  queue_type EventQueue; // data structure of the scheduler's event queue
+  backoff_type Backoff;  // engine of the backoff countdown
+  string FadingTrace; // prefix of fading trace files, empty if not used
   
   ////////////////////////////////
   // standard
@@ -192,6 +197,7 @@ class Parameters {
   param_vec_double TargetPER;
   param_vec_bandwidth Bandwidth;
   param_vec_bool shortGI;
+  param_vec_bool PERTable; // PER from lookup table instead of polynomial
 
   ///////////////////////////////
   // Link Adaptation parameters
@@ -217,6 +223,7 @@ class Parameters {
   param_vec_double DopplerSpread_Hz;
   param_vec_unsigned NumberSinus;
   param_vec_model	ChannelModel;
+  param_vec_bool InterferenceFading; // interference links are time-variant
 
   /////////////////////////
   // IEEE 802.11 MAC parameters
@@ -253,6 +260,7 @@ public:
   // return configuration fields
   adapt_mode get_AdaptMode() {return AdaptMode.current();}  
   arrival_time_type get_ArrivalTime() {return ArrivalTime.current();}
+  backoff_type get_Backoff() {return Backoff;}
   double get_CCASensitivity() {return CCASensitivity_dBm.current();}
   double get_Confidence() {return Confidence;}
   double get_DataRateDL() {return DataRate.current() * DownlinkFactor.current()
@@ -260,6 +268,8 @@ public:
   double get_DataRateUL() {return DataRate.current() * UplinkFactor.current()
                                                      * 1.0e6;}
   double get_DopplerSpread() {return DopplerSpread_Hz.current();}
+  queue_type get_EventQueue() {return EventQueue;}
+  string get_FadingTrace() {return FadingTrace;}
   unsigned get_FragmentationThresh() {return FragmentationThresh.current();}
   unsigned get_LAMaxSucceedCounter() {return LAMaxSucceedCounter.current();}
   unsigned get_LAFailLimit() {return LAFailLimit.current();}
@@ -279,6 +289,7 @@ public:
   unsigned long get_Seed() {return Seed.current();}
   double get_TargetPER() {return TargetPER.current();}
   timestamp get_TempOutputInterval() {return TempOutputInterval;}
+  unsigned get_Threads() {return Threads;}
   timestamp get_TransientTime() {return TransientTime;}
   transmission_mode get_TxMode() {return TxMode.current();}
   double get_TxPowerMax() {return TxPowerMax_dBm.current();}
@@ -296,6 +307,8 @@ public:
   dot11_standard get_standard() {return standard.current();}
   channel_bandwidth get_bandwidth() {return Bandwidth.current();}
   bool get_shortGI() {return shortGI.current();}
+  bool get_PERTable() {return PERTable.current();}
+  bool get_InterferenceFading() {return InterferenceFading.current();}
   channel_model get_channelModel() {return ChannelModel.current();}
 
   Position get_APPosition(unsigned which_ap);
@@ -304,6 +317,9 @@ public:
   unsigned get_number_of_Seeds()     {return Seed.size();}
   // returns number of different seeds
 
+  unsigned get_number_of_iterations();
+  // returns number of parameter combinations (including seeds)
+
   bool is_default () {return default_flag;}
   // returns true if default configuration is employed
 
@@ -318,6 +334,10 @@ public:
   void reset_iterations();
   // go back to first iteration
 
+  void set_iteration(unsigned n);
+  // go to iteration number 'n' (first iteration is 0), in the same order as
+  // given by 'new_iteration'
+
   /////////////////////////////////////////
   // outputs current simulation parameters 
   friend ostream& operator<< (ostream& os, const Parameters& p);
@@ -28,12 +28,13 @@
 #include <vector>
 #include <string>
 #include <fstream>
+#include <mutex>
 
 #include "myexception.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // the comment in the following line must be removed to activate the profiler:
-//#define _PROFILE_ _this_profiler_
+//#define _PROFILE_ (ctx->profiler)
 // and the program must be recompiled.
 //
 // functions (or pieces of code) to be profiled must have 
@@ -42,6 +43,10 @@
 //   END_PROF("function_name")
 // at each exit point.
 //
+// Each simulation profiles into the Profiler of its SimContext 'ctx', which
+// is merged into '_this_profiler_' at the end of the simulation with 'add'.
+// If simulations run in parallel threads, processing times may add up to more
+// than the total time.
 // Profiling results are output at file "profile.txt"
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -79,13 +84,15 @@ class Profiler {
   __int64 tquery;  // approximate time required for a counter query
   __int64 tcall; // approximate time for a function call
   __int64 tcall2; // approximate time for a function call
-  string filename;
+  string filename; // results are written to this file, if not empty
+
+  mutex add_mutex; // serializes calls to 'add'
 
 public:
   /////////////////
   // Constructor //
   /////////////////
-  Profiler(string str = "profile.txt") : filename(str) {
+  Profiler(string str = "") : filename(str) {
 
     LARGE_INTEGER f;
     QueryPerformanceFrequency(&f);
@@ -115,6 +122,8 @@ public:
   // Destructor //
   ////////////////
   ~Profiler() {
+    if (filename.empty()) return;
+
     QueryPerformanceCounter(&t);
 
     __int64 total_time = t.QuadPart - start;
@@ -185,6 +194,20 @@ public:
     current.push_back(t.QuadPart);
   }
 
+  /////////
+  // add //
+  /////////
+  void add(const Profiler& p) {
+    lock_guard<mutex> lock(add_mutex);
+
+    map<string,prof_struct>::const_iterator it = p.profile.begin();
+    while (it != p.profile.end()) {
+      profile[it->first].proc_time += (it->second).proc_time;
+      profile[it->first].ntimes += (it->second).ntimes;
+      it++;
+    }
+  }
+
   /////////
   // end //
   /////////
@@ -59,35 +59,59 @@ public:
 ////////////////////////////////////////////////////////////////////////////////
 // class Event                                                                //
 ////////////////////////////////////////////////////////////////////////////////
-long_integer Event::event_count = 0;
-
 ////////////////////////////////////////////////////////////////////////////////
 // Event Constructors                                                         //
 ////////////////////////////////////////////////////////////////////////////////
-Event::Event() {
-  p_obj = NULL;
-  p_fun = NULL;
-  p_param = NULL;
-
-  when = timestamp(0);
-  active = false;
+Event::Event() : when(0), call(0), p_obj(0), p_fun(0), id(not_a_long_integer),
+                 slot(0), active(false), priority(PRIO_NORMAL) {
+  arg.ptr = 0;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+Event::Event(timestamp t, void* po, event_arg a, void (*c)(const Event&))
+             : when(t), call(c), p_obj(po), arg(a), p_fun(0),
+               id(not_a_long_integer), slot(0), active(true),
+               priority(PRIO_NORMAL) {}
+
 ////////////////////////////////////////////////////////////////////////////////
 Event :: Event(timestamp t, void* pf, void* po, void* p1)
-              : when(t), p_fun(pf), p_obj(po),
-                p_param(p1) {
-  id = event_count++;
-  li_param_flag = false;
-  active = true;
+              : when(t), p_obj(po), p_fun(pf), id(not_a_long_integer),
+                slot(0), active(true), priority(PRIO_NORMAL) {
+  arg.ptr = p1;
+
+  if (p1) call = &call_function_obj_ptr;
+  else if (po) call = &call_function_obj;
+  else if (pf) call = &call_function;
+  else call = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 Event :: Event(timestamp t, void* pf, void* po, long_integer li)
-              : when(t), p_fun(pf), p_obj(po), li_param(li) {
-  id = event_count++;
-  li_param_flag = true;
-  active = true;
+              : when(t), call(&call_function_obj_li), p_obj(po), p_fun(pf),
+                id(not_a_long_integer), slot(0), active(true),
+                priority(PRIO_NORMAL) {
+  arg.li = li;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Event::call_function...                                                    //
+//                                                                            //
+// call-back of static functions given to the compatibility constructors      //
+////////////////////////////////////////////////////////////////////////////////
+void Event::call_function(const Event& e) {
+  (ptr2func(e.p_fun)) ();
+}
+
+void Event::call_function_obj(const Event& e) {
+  (ptr2func_onepar(e.p_fun))(e.p_obj);
+}
+
+void Event::call_function_obj_ptr(const Event& e) {
+  (ptr2func_twopars(e.p_fun))(e.p_obj, e.arg.ptr);
+}
+
+void Event::call_function_obj_li(const Event& e) {
+  (ptr2func_twopars_li(e.p_fun))(e.p_obj, e.arg.li);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -100,40 +124,208 @@ int Event::go() {
     return 0;
   }
 
-  if (li_param_flag) {
-    (ptr2func_twopars_li(p_fun))(p_obj,li_param);
-  } else if (p_param) {
-    (ptr2func_twopars(p_fun))(p_obj, p_param);
-  } else if (p_obj) {
-    (ptr2func_onepar(p_fun))(p_obj);
-  } else if (p_fun) {
-    (ptr2func(p_fun)) ();
-  } else {
-    throw my_exception (EVENT,id, "invalid event");
-  }
+  if (!call) throw my_exception (EVENT,id, "invalid event");
+  call(*this);
 
   active = false;
   return 1;
 }
 
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// enum queue_type                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////
+// output operator << //
+////////////////////////
+ostream& operator<< (ostream& os, const queue_type& q) {
+  switch(q) {
+    case HEAP: return os << "HEAP";
+    case CALENDAR: return os << "CALENDAR";
+  }
+  return os;
+}
+
+///////////////////////
+// input operator >> //
+///////////////////////
+istream& operator>> (istream& is, queue_type& q) {
+  string str;
+  is >> str;
+
+  if (str == "HEAP") q = HEAP;
+  else if (str == "CALENDAR") q = CALENDAR;
+  else is.clear(ios::failbit);
+
+  return is;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class heap_queue                                                           //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// heap_queue::pop                                                            //
+////////////////////////////////////////////////////////////////////////////////
+Event heap_queue::pop() {
+  Event e = top();
+  priority_queue::pop();
+  return e;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// heap_queue::find                                                           //
+////////////////////////////////////////////////////////////////////////////////
+Event* heap_queue::find(void* pf, void* po) {
+  vector<Event>::iterator it = find_if(c.begin(), c.end(), same_event(pf,po));
+
+  return (it != c.end())? &(*it) : 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class calendar_queue                                                       //
+////////////////////////////////////////////////////////////////////////////////
+
+// number of events used to estimate the bucket width
+const unsigned cq_width_samples = 25;
+
+// timestamp in time units
+inline long_integer cq_ticks(const Event& e) {
+  return e.get_time() / timestamp(long_integer(1));
+}
+
+// true if event 'e1' should be performed before 'e2'
+inline bool cq_earlier(const Event& e1, const Event& e2) {
+  return e1 < e2;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
-// Event:: comparison operators                                               //
+// calendar_queue::clear                                                      //
 ////////////////////////////////////////////////////////////////////////////////
+void calendar_queue::clear() {
+  bucket.assign(2, deque<Event>());
+
+  width = 1;
+  current = 0;
+  bucket_end = width;
+  last = 0;
 
-bool Event::operator< (Event e) const {
-     return when < e.when;
+  n = 0;
+  shrink_thresh = 0;
+  grow_thresh = 2 * bucket.size();
 }
 
-bool Event::operator<= (Event e) const {
-     return when <= e.when;
+////////////////////////////////////////////////////////////////////////////////
+// calendar_queue::push                                                       //
+////////////////////////////////////////////////////////////////////////////////
+void calendar_queue::push(const Event& e) {
+  deque<Event>& b = bucket[(cq_ticks(e) / width) % bucket.size()];
+
+  b.insert(upper_bound(b.begin(), b.end(), e, cq_earlier), e);
+
+  if (++n > grow_thresh) resize(2 * bucket.size());
 }
 
-bool Event::operator> (Event e) const {
-     return when > e.when;
+////////////////////////////////////////////////////////////////////////////////
+// calendar_queue::pop                                                        //
+//                                                                            //
+// returns and removes event with lowest timestamp, queue must not be empty   //
+////////////////////////////////////////////////////////////////////////////////
+Event calendar_queue::pop() {
+  unsigned nb = bucket.size();
+
+  // look for next event in current year
+  unsigned i = 0;
+  for (; i < nb; ++i) {
+    deque<Event>& b = bucket[current];
+    if (!b.empty() && cq_ticks(b.front()) < bucket_end) break;
+
+    if (++current == nb) current = 0;
+    bucket_end += width;
+  }
+
+  if (i == nb) {
+    // no event in current year, go directly to the earliest event
+    unsigned first = nb;
+    for (unsigned k = 0; k < nb; ++k) {
+      if (!bucket[k].empty() && (first == nb
+          || cq_earlier(bucket[k].front(), bucket[first].front()))) first = k;
+    }
+
+    current = first;
+    bucket_end = (cq_ticks(bucket[first].front()) / width + 1) * width;
+  }
+
+  Event e = bucket[current].front();
+  bucket[current].pop_front();
+  last = cq_ticks(e);
+
+  if (--n < shrink_thresh) resize(nb / 2);
+
+  return e;
 }
 
-bool Event::operator>= (Event e) const {
-     return when >= e.when;
+////////////////////////////////////////////////////////////////////////////////
+// calendar_queue::resize                                                     //
+//                                                                            //
+// redistributes all events among 'nbuckets' buckets, with a new bucket width //
+// of three times the average spacing of the earliest events.                 //
+////////////////////////////////////////////////////////////////////////////////
+void calendar_queue::resize(unsigned nbuckets) {
+  vector<Event> events;
+  events.reserve(n);
+  for (vector< deque<Event> >::iterator it = bucket.begin();
+       it != bucket.end(); ++it) {
+    events.insert(events.end(), it->begin(), it->end());
+  }
+  sort(events.begin(), events.end(), cq_earlier);
+
+  // estimate new bucket width, ignoring unusually large separations
+  unsigned nsamples = min<size_t>(events.size(), cq_width_samples);
+  if (nsamples > 1) {
+    long_integer total = cq_ticks(events[nsamples-1]) - cq_ticks(events[0]);
+    double avg = double(total) / (nsamples - 1);
+
+    long_integer sum = 0;
+    unsigned count = 0;
+    for (unsigned k = 1; k < nsamples; ++k) {
+      long_integer sep = cq_ticks(events[k]) - cq_ticks(events[k-1]);
+      if (sep <= 2.0 * avg) {
+        sum += sep;
+        ++count;
+      }
+    }
+
+    width = count? 3 * sum / count : 1;
+    if (!width) width = 1;
+  }
+
+  bucket.assign(nbuckets, deque<Event>());
+  for (vector<Event>::iterator it = events.begin(); it != events.end(); ++it)
+    bucket[(cq_ticks(*it) / width) % nbuckets].push_back(*it);
+
+  current = (last / width) % nbuckets;
+  bucket_end = (last / width + 1) * width;
+
+  shrink_thresh = (nbuckets > 2)? nbuckets / 2 - 2 : 0;
+  grow_thresh = 2 * nbuckets;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// calendar_queue::find                                                       //
+////////////////////////////////////////////////////////////////////////////////
+Event* calendar_queue::find(void* pf, void* po) {
+  for (vector< deque<Event> >::iterator b = bucket.begin();
+       b != bucket.end(); ++b) {
+    deque<Event>::iterator it = find_if(b->begin(), b->end(),
+                                        same_event(pf,po));
+    if (it != b->end()) return &(*it);
+  }
+  return 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -141,45 +333,69 @@ bool Event::operator>= (Event e) const {
 // class Scheduler                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 
+////////////////////////////////////////////////////////////////////////////////
+// Scheduler constructor                                                      //
+////////////////////////////////////////////////////////////////////////////////
+Scheduler::Scheduler(queue_type q) : event_count(0), processed(0) {
+  switch (q) {
+    case CALENDAR: queue = new calendar_queue;
+                   break;
+    default:       queue = new heap_queue;
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // Scheduler::init                                                            //
 ////////////////////////////////////////////////////////////////////////////////
 void Scheduler::init () {
   present = timestamp(0);
+  processed = 0;
 
   // clear events_list
-  while(!empty()) pop();
+  queue->clear();
+  slots.clear();
+  free_slots.clear();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Scheduler::schedule                                                        //
 ////////////////////////////////////////////////////////////////////////////////
-long_integer Scheduler::schedule(Event e) {
+event_handle Scheduler::schedule(Event e) {
 
     if (e.get_time() < now())
       throw(my_exception(EVENT,e.get_id(),"scheduling in the past"));
 
-    push(e);
-    return e.get_id();
+    e.id = event_count++;
+
+    if (free_slots.empty()) {
+      e.slot = slots.size();
+      slots.push_back(event_slot());
+    } else {
+      e.slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    slots[e.slot].id = e.id;
+    slots[e.slot].cancelled = false;
+
+    queue->push(e);
+    return event_handle(e.slot, e.id);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 // Scheduler::remove                                                          //
 ////////////////////////////////////////////////////////////////////////////////
-void Scheduler :: remove (long_integer event_id) {
-  vector<Event>::iterator it = find_if(c.begin(), c.end(),
-                                       same_event(event_id));
-
-  if (it != c.end()) it->deactivate();
+void Scheduler :: remove (event_handle h) {
+  if (h.id != not_a_long_integer && h.slot < slots.size()
+      && slots[h.slot].id == h.id) {
+    slots[h.slot].cancelled = true;
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 void Scheduler :: remove (void* pf, void* po) {
-  vector<Event>::iterator it = find_if(c.begin(), c.end(), same_event(pf,po));
+  Event* e = queue->find(pf,po);
 
-  if (it != c.end()) {
-    it->deactivate();
-  }
+  if (e) e->deactivate();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -189,15 +405,20 @@ void Scheduler :: run (timestamp tmax) {
 
 Event next;
 
-  while (!empty()) {
+  while (!queue->empty()) {
     // get next event
-    next = top();
-    pop();
+    next = queue->pop();
+
+    // release cancellation slot
+    event_slot& s = slots[next.slot];
+    bool cancelled = s.cancelled;
+    s.id = not_a_long_integer;
+    free_slots.push_back(next.slot);
 
     present = next.get_time();
 
     if (present > tmax) return;
-    next.go();
+    if (!cancelled) processed += next.go();
   }
   throw(my_exception(GENERAL,"Scheduler is empty"));
 }
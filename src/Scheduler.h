@@ -24,12 +24,32 @@
 #define _Scheduler_h 1
 
 #include <queue>
+#include <deque>
+#include <vector>
 #include <functional>
+#include <iostream>
 
 #include "timestamp.h"
 #include "long_integer.h"
 
 
+////////////////////////////////////////////////////////////////////////////////
+// enum event_priority                                                        //
+//                                                                            //
+// processing order of events with the same timestamp                         //
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {PRIO_HIGH, PRIO_NORMAL, PRIO_LOW} event_priority;
+
+////////////////////////////////////////////////////////////////////////////////
+// union event_arg                                                            //
+//                                                                            //
+// parameter of an event call-back                                            //
+////////////////////////////////////////////////////////////////////////////////
+union event_arg {
+  void*        ptr;
+  long_integer li;
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // class Event                                                                //
 //                                                                            //
@@ -38,6 +58,16 @@
 // Usage:                                                                     //
 // - each event is instanced with a time stamp, an action and (optionally) a  //
 //   parameter                                                                //
+// - the action is preferably a member function, given as template arguments  //
+//   to 'callback', e.g.                                                      //
+//     Event::callback<MAC_private, &MAC_private::tx_attempt>(t, this)        //
+//   The member function may have no parameter, a pointer parameter or a      //
+//   long_integer parameter.                                                  //
+// - the constructors with void* function pointers are kept for compatibility //
+//   with static wrapper functions. They are also dispatched with a single    //
+//   call, but only these events can be removed from the scheduler through    //
+//   their function pointers.                                                 //
+// - events have normal priority, unless changed with 'set_priority'          //
 // - action is performed by calling 'go'                                      //
 // - instanced events can be deactivated with 'deactivate', in which case     //
 //   action will not be performed                                             //
@@ -45,18 +75,42 @@
 class Event{
       timestamp when; // time at which event should be performed
 
-      void* p_fun; // pointer to function
-      void* p_obj; // pointer to object (used with member function)
+      void (*call)(const Event&); // performs the action
+      void* p_obj;   // pointer to object (used with member function)
+      event_arg arg; // function parameter
+      void* p_fun;   // pointer to static function (compatibility constructors)
 
-      // function parameters
-      void* p_param;         // pointer parameter
-      long_integer li_param; // long_integer parameter
-      bool li_param_flag;    // true if a long_integer parameter was defined
-
-      static long_integer event_count; // number of events already created
-      long_integer id;                 // event unique identification number
+      long_integer id; // event unique identification number, set by Scheduler
+      unsigned slot;   // cancellation slot in Scheduler, set by Scheduler
 
       bool active; // event is only carried out if active==true
+      unsigned char priority; // event_priority, orders simultaneous events
+
+      friend class Scheduler;
+
+      Event(timestamp t, void* po, event_arg a, void (*c)(const Event&));
+      // event calling 'c' at time 't'
+
+      ////////////////////////////////////
+      // call-back of member functions
+      template <class T, void (T::*F)()>
+      static void call_member(const Event& e) {
+        (static_cast<T*>(e.p_obj)->*F)();}
+
+      template <class T, class P, void (T::*F)(P*)>
+      static void call_member_ptr(const Event& e) {
+        (static_cast<T*>(e.p_obj)->*F)(static_cast<P*>(e.arg.ptr));}
+
+      template <class T, void (T::*F)(long_integer)>
+      static void call_member_li(const Event& e) {
+        (static_cast<T*>(e.p_obj)->*F)(e.arg.li);}
+
+      ////////////////////////////////////
+      // call-back of static functions
+      static void call_function(const Event& e);
+      static void call_function_obj(const Event& e);
+      static void call_function_obj_ptr(const Event& e);
+      static void call_function_obj_li(const Event& e);
 
 public:
   Event();
@@ -71,6 +125,26 @@ public:
         long_integer li // (optional) parameter
         );
 
+  template <class T, void (T::*F)()>
+  static Event callback(timestamp t, T* obj) {
+    event_arg a;
+    a.ptr = 0;
+    return Event(t, static_cast<void*>(obj), a, &call_member<T,F>);
+  }
+  template <class T, class P, void (T::*F)(P*)>
+  static Event callback(timestamp t, T* obj, P* param) {
+    event_arg a;
+    a.ptr = static_cast<void*>(param);
+    return Event(t, static_cast<void*>(obj), a, &call_member_ptr<T,P,F>);
+  }
+  template <class T, void (T::*F)(long_integer)>
+  static Event callback(timestamp t, T* obj, long_integer param) {
+    event_arg a;
+    a.li = param;
+    return Event(t, static_cast<void*>(obj), a, &call_member_li<T,F>);
+  }
+  // event calling member function 'F' of object '*obj' at time 't'
+
   int go(); // perform event
 
   timestamp    get_time () const {return when;}
@@ -78,16 +152,134 @@ public:
 
   void deactivate() {active = false;}
 
+  Event& set_priority(event_priority p) {priority = p; return *this;}
+  // events with the same timestamp are performed in order of priority
+
   bool same_id (long_integer l) const { return(id==l && active);}
   bool same_pointers (void* pf, void* po) const {
-    return(pf==p_fun && p_obj==po && active);
+    return(p_fun && pf==p_fun && p_obj==po && active);
+  }
+
+  // comparison operators are based on the event timestamp, then on the
+  // priority and then on the identification number, i.e., the order in which
+  // events were scheduled
+  bool operator< (const Event& e) const {
+    if (when != e.when) return when < e.when;
+    if (priority != e.priority) return priority < e.priority;
+    return id < e.id;
   }
+  bool operator> (const Event& e) const {return e < *this;}
+  bool operator<= (const Event& e) const {return !(e < *this);}
+  bool operator>= (const Event& e) const {return !(*this < e);}
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// struct event_handle                                                        //
+//                                                                            //
+// identifies a scheduled event, allows its cancellation in constant time     //
+////////////////////////////////////////////////////////////////////////////////
+struct event_handle {
+  unsigned     slot; // cancellation slot of the event in the scheduler
+  long_integer id;   // event identification number
+
+  event_handle() : slot(0), id(not_a_long_integer) {}
+  event_handle(unsigned s, long_integer i) : slot(s), id(i) {}
+};
+
+
+////////////////////////////////////////////////////////////////////////////////
+// enum queue_type                                                            //
+//                                                                            //
+// data structure used by the scheduler to store pending events               //
+////////////////////////////////////////////////////////////////////////////////
+typedef enum {HEAP, CALENDAR} queue_type;
 
-  // comparison operators are based on the event timestamp
-  bool operator< (Event e) const;
-  bool operator<= (Event e) const;
-  bool operator> (Event e) const;
-  bool operator>= (Event e) const;
+ostream& operator<< (ostream& os, const queue_type& q);
+istream& operator>> (istream& is, queue_type& q);
+
+
+////////////////////////////////////////////////////////////////////////////////
+// class event_queue                                                          //
+//                                                                            //
+// abstract base class for the pending event set of a scheduler               //
+//                                                                            //
+// 'pop' returns and removes the event with the lowest timestamp. Events must //
+// not be pushed with a timestamp lower than the one of the latest popped     //
+// event.                                                                     //
+////////////////////////////////////////////////////////////////////////////////
+class event_queue {
+public:
+  virtual ~event_queue() {}
+
+  virtual void push(const Event& e) = 0;
+  virtual Event pop() = 0;
+  virtual void clear() = 0;
+
+  virtual bool empty() const = 0;
+  virtual size_t size() const = 0;
+
+  virtual Event* find(void* pf, void* po) = 0;
+  // returns pointer to active event with given call-back pointers, 0 if there
+  // is none
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// class heap_queue                                                           //
+//                                                                            //
+// event set implemented as a binary heap, O(log n) per operation             //
+////////////////////////////////////////////////////////////////////////////////
+class heap_queue : public event_queue,
+                   private priority_queue< Event,vector<Event>,greater<Event> >{
+public:
+  void push(const Event& e) {priority_queue::push(e);}
+  Event pop();
+  void clear() {c.clear();}
+
+  bool empty() const {return priority_queue::empty();}
+  size_t size() const {return priority_queue::size();}
+
+  Event* find(void* pf, void* po);
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// class calendar_queue                                                       //
+//                                                                            //
+// event set implemented as a calendar queue (R. Brown, Comm. ACM, 1988).     //
+//                                                                            //
+// Events are hashed by timestamp into 'bucket', each bucket covering an      //
+// interval of 'width' time units of a "year" of bucket.size()*width units.   //
+// Each bucket is kept sorted. Events are dequeued by visiting the buckets    //
+// cyclically, so that push and pop have O(1) amortized cost if the bucket    //
+// width is adequate.                                                         //
+// The number of buckets follows the number of events, and the bucket width   //
+// is recalculated from the spacing of the earliest events at each resize.    //
+////////////////////////////////////////////////////////////////////////////////
+class calendar_queue : public event_queue {
+  vector< deque<Event> > bucket;
+
+  long_integer width;      // bucket width in time units
+  unsigned     current;    // bucket of the latest popped event
+  long_integer bucket_end; // end of current bucket in current year
+  long_integer last;       // timestamp of the latest popped event
+
+  size_t   n;              // number of events in queue
+  size_t   shrink_thresh;  // halve number of buckets below this size
+  size_t   grow_thresh;    // double number of buckets above this size
+
+  void resize(unsigned nbuckets);
+
+public:
+  calendar_queue() {clear();}
+
+  void push(const Event& e);
+  Event pop();
+  void clear();
+
+  bool empty() const {return !n;}
+  size_t size() const {return n;}
+
+  Event* find(void* pf, void* po);
 };
 
 
@@ -98,30 +290,57 @@ public:
 //                                                                            //
 // Usage:                                                                     //
 // - Scheduler consists of a priority queue of Events. Events with lower      //
-//   timestamps are called back first. No processing order is guaranteed for  //
-//   Events with the same timestamp.                                          //
-// - events are added to the scheduler with 'schedule'.                       //
-// - events can be removed from scheduler with 'remove'.                      //
+//   timestamps are called back first. Events with the same timestamp are     //
+//   called back in order of priority and then in the order in which they     //
+//   were scheduled, so that the processing order does not depend on the      //
+//   queue type.                                                              //
+// - the priority queue is either a binary heap or a calendar queue, as       //
+//   given to the constructor.                                                //
+// - events are added to the scheduler with 'schedule', which assigns them a  //
+//   unique identification number and returns a handle to the event.          //
+// - events can be removed from scheduler with 'remove'. Removal through the  //
+//   event handle takes constant time: the event is only marked as cancelled  //
+//   and discarded when it leaves the queue. Removal through the call-back    //
+//   pointers requires a search of the complete queue and should not be mixed //
+//   with removal through handles for the same kind of events.                //
 // - 'run' starts simulation.                                                 //
 ////////////////////////////////////////////////////////////////////////////////
-class Scheduler
-      : private priority_queue< Event,vector<Event>,greater<Event> >{
+class Scheduler {
+
+  event_queue* queue; // pending events
+
+  struct event_slot {
+    long_integer id; // event occupying the slot, not_a_long_integer if free
+    bool cancelled;
+  };
+  vector<event_slot> slots;    // cancellation state of the pending events
+  vector<unsigned> free_slots; // slots available for new events
 
   timestamp present;
+  long_integer event_count; // number of events scheduled
+  long_integer processed;   // number of events performed
+
+  Scheduler(const Scheduler&);
+  Scheduler& operator= (const Scheduler&);
+  // schedulers cannot be copied
+
 public:
-  Scheduler() {}
+  Scheduler(queue_type q = HEAP);
+  ~Scheduler() {delete queue;}
 
   void init (); // clear queue
 
-  long_integer schedule(Event e); // add event to scheduler, returns event id
+  event_handle schedule(Event e); // add event to scheduler, returns its handle
 
-  void remove (long_integer event_id); // removes (deactivates) event
+  void remove (event_handle h); // removes (cancels) event
   void remove (void* pf, void* po);
 
   void run(timestamp tmax); // run scheduler until tmax is reached
 
   timestamp now() const {return present;} // returns current simulation time
-  int n_events () const {return size();}  // returms number of events in queue
+  int n_events () const {return queue->size();} // returns number of events in queue
+  long_integer n_processed () const {return processed;}
+  // returns number of events performed since 'init'
 };
 
 #endif
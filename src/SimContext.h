@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2002-2015 by Microwave and Wireless Systems Laboratory, by Andre Barreto and Calil Queiroz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef _SimContext_h
+#define _SimContext_h 1
+
+#include <map>
+
+#include "long_integer.h"
+#include "Standard.h"
+#include "Profiler.h"
+#include "mymath.h"
+
+////////////////////////////////////////////////////////////////////////////////
+// class SimContext                                                           //
+//                                                                            //
+// state shared by all objects of one simulation                              //
+//                                                                            //
+// Usage:                                                                     //
+// - one SimContext is created for each simulated iteration. Channel, PHY,    //
+//   MAC, Terminal, Traffic, link adaptation and packets keep a pointer to    //
+//   the context of their simulation, instead of using global variables.      //
+//   Independent simulations may therefore run in parallel threads.           //
+// - the standard must be configured with 'standard.set_standard' before any  //
+//   packet is created.                                                       //
+// - the counters give unique identification numbers to the objects of this   //
+//   simulation.                                                              //
+// - FFT plans and raised-cosine interpolation tables are shared by all       //
+//   channel links of the simulation. They are created at first use, after    //
+//   the standard has been configured.                                        //
+////////////////////////////////////////////////////////////////////////////////
+class SimContext {
+public:
+  Standard standard; // simulated IEEE 802.11 standard
+
+  long_integer packet_count; // number of packets already created
+  unsigned     nphys;        // number of instanced PHYs
+  unsigned     nterm;        // number of instanced terminals
+
+#ifdef _PROFILE_
+  Profiler profiler; // profiling results of this simulation
+#endif
+
+  map<unsigned, fft_plan> fft_plans; // FFT plans by length
+  map<int, raisedcos_table> interp_tables; // tap interpolation by channel model
+
+  SimContext(unsigned first_term = 0)
+            : packet_count(0), nphys(0), nterm(first_term) {}
+
+  const fft_plan& get_fft_plan(unsigned n) {
+    map<unsigned, fft_plan>::iterator it = fft_plans.find(n);
+    if (it == fft_plans.end())
+      it = fft_plans.insert(make_pair(n, fft_plan(n))).first;
+    return it->second;
+  }
+  // returns FFT plan of length 'n', which is created at first use
+
+  const raisedcos_table& get_interp_table(int model,
+                                          const valarray<double>& delay) {
+    map<int, raisedcos_table>::iterator it = interp_tables.find(model);
+    if (it == interp_tables.end())
+      it = interp_tables.insert(make_pair(model, raisedcos_table(delay,
+                standard.get_band_double(), standard.get_rollof()))).first;
+    return it->second;
+  }
+  // returns interpolation table of the taps of channel model 'model' with
+  // delays 'delay', for the bandwidth and roll-off of the standard
+};
+
+#endif
@@ -23,10 +23,13 @@
 #include "Simulation.h"
 #include "myexception.h"
 #include "DataStatistics.h"
-#include "Standard.h"
+#include "SimContext.h"
+#include "Profiler.h"
 
 #include <iomanip>
 #include <sstream>
+#include <thread>
+#include <chrono>
 #include <math.h>
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -342,11 +345,224 @@ void Simulation::final_results(){
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Simulation::init_terminals                                                 //
+// Simulation::run                                                            //
+//                                                                            //
+// starts all simulations, iterates over all parameter combinations           //
+////////////////////////////////////////////////////////////////////////////////
+void Simulation::run() {
+
+	/////////////////////////////////////////////////////////
+	// list all iterations and the number of their first terminal
+	unsigned first_id = 0;
+	do {
+		jobs.push_back(sweep_job(first_id));
+		first_id += sim_par.get_NumberAPs() + sim_par.get_NumberStas();
+	} while (sim_par.new_iteration());
+
+	unsigned n_threads = sim_par.get_Threads();
+	if (!n_threads) n_threads = thread::hardware_concurrency();
+
+	// log file is shared by all iterations
+	if (log.active()) n_threads = 1;
+
+	if (n_threads > jobs.size()) n_threads = jobs.size();
+
+	if (n_threads > 1) run_parallel(n_threads);
+	else run_serial();
+
+	final_results();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Simulation::run_serial                                                     //
+//                                                                            //
+// simulates all iterations in the main thread                                //
+////////////////////////////////////////////////////////////////////////////////
+void Simulation::run_serial() {
+
+	sim_par.reset_iterations();
+	for (unsigned n = 0; n < jobs.size(); ++n, sim_par.new_iteration()) {
+		Iteration it(sim_par, n+1, log, out, cout);
+		results.push_back(it.run(jobs[n].first_id));
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Simulation::run_parallel                                                   //
+//                                                                            //
+// simulates all iterations with 'n_threads' worker threads. Outputs and      //
+// results are collected in iteration order as soon as they are available.    //
+////////////////////////////////////////////////////////////////////////////////
+void Simulation::run_parallel(unsigned n_threads) {
+
+	next_job = 0;
+	abort_flag = false;
+
+	vector<thread> workers;
+	for (unsigned i = 0; i < n_threads; ++i)
+		workers.push_back(thread(&Simulation::worker, this));
+
+	exception_ptr error;
+	for (vector<sweep_job>::iterator it = jobs.begin(); it != jobs.end(); ++it) {
+		{
+			unique_lock<mutex> lock(job_mutex);
+			while (!it->done) job_done.wait(lock);
+		}
+
+		out << it->out_str;
+		cout << it->con_str << flush;
+
+		if (it->error) {
+			error = it->error;
+			abort_flag = true;
+			break;
+		}
+		results.push_back(it->res);
+	}
+
+	for (vector<thread>::iterator it = workers.begin(); it != workers.end(); ++it)
+		it->join();
+
+	if (error) rethrow_exception(error);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Simulation::worker                                                         //
+//                                                                            //
+// worker thread, simulates iterations until all of them are taken            //
+////////////////////////////////////////////////////////////////////////////////
+void Simulation::worker() {
+
+	// each thread iterates over its own copy of the parameters
+	Parameters par;
+	bool par_ok = par.read_param(wdir);
+
+	unsigned n;
+	while (!abort_flag && (n = next_job++) < jobs.size()) {
+		sweep_job& job = jobs[n];
+		ostringstream job_out, job_con;
+
+		try {
+			if (!par_ok) throw (my_exception(CONFIG));
+
+			par.set_iteration(n);
+			Iteration it(par, n+1, log, job_out, job_con);
+			job.res = it.run(job.first_id);
+		}
+		catch (...) {
+			job.error = current_exception();
+		}
+
+		job.out_str = job_out.str();
+		job.con_str = job_con.str();
+
+		{
+			lock_guard<mutex> lock(job_mutex);
+			job.done = true;
+		}
+		job_done.notify_all();
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class Iteration                                                            //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// Iteration constructor                                                      //
+////////////////////////////////////////////////////////////////////////////////
+Iteration::Iteration(Parameters& p, unsigned n, log_file& l, ostream& o,
+		ostream& c) : sim_par(p), main_sch(p.get_EventQueue()), ch(0),
+		backoff(p.get_Backoff()), log(l), out(o), con(c), n_it(n) {}
+
+////////////////////////////////////////////////////////////////////////////////
+// Iteration destructor                                                       //
+////////////////////////////////////////////////////////////////////////////////
+Iteration::~Iteration() {
+	delete ch;
+	for (vector<Terminal*>::iterator it = term_vector.begin();
+			it != term_vector.end(); ++it) delete *it;
+	for (vector<Contention*>::iterator it = domains.begin();
+			it != domains.end(); ++it) delete *it;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Iteration::run                                                             //
+//                                                                            //
+// simulates iteration and returns its results                                //
+////////////////////////////////////////////////////////////////////////////////
+res_struct Iteration::run(unsigned first_id) {
+
+	if(sim_par.get_partResults()) {
+		out << "\n\nIteration " << n_it << "\n    " << sim_par << "\n" << endl;
+	}
+	con << "\n\nIteration " << n_it << "\n    " << sim_par << "\n" << endl;
+
+	if (log(log_type::setup))
+		log << "\n\nIteration " << n_it << "\n\t" << sim_par << "\n"
+		<< endl;
+
+	/*
+#ifdef _SAVE_RATE_ADAPT
+    rate_adapt_file_ch << "\n\nIteration " << n_it << "\n\t" << sim_par << "\n"
+                       << "Time      ,term 1,term 2,path loss ,"
+                       << "fading(R) ,fading(I)\n";
+    rate_adapt_file_ch.setf(ios::left);
+    rate_adapt_file_rt << "\n\nIteration " << n_it << "\n\t" << sim_par << "\n"
+                       << "Time      ,sender,target,data rate\n";
+    rate_adapt_file_rt.setf(ios::left);
+#endif
+	 */
+	main_sch.init();
+
+	randgent.seed(sim_par.get_Seed());
+
+	ctx.standard.set_standard(sim_par.get_standard(),sim_par.get_bandwidth(),
+			sim_par.get_shortGI(), sim_par.get_PERTable());
+	if(sim_par.get_TxMode() > ctx.standard.get_maxMCS())
+		throw (my_exception("MCS not supported by standard."));
+
+	channel_struct ch_par(sim_par.get_LossExponent(),
+			sim_par.get_RefLoss(),
+			sim_par.get_DopplerSpread(),
+			sim_par.get_NumberSinus(),
+			sim_par.get_channelModel(),
+			sim_par.get_TxPowerMax(),
+			sim_par.get_CCASensitivity(),
+			sim_par.get_InterferenceFading());
+
+	ch = new Channel(&main_sch, &randgent, &ctx, ch_par, &log);
+
+	// terminals are numbered as if all iterations were run in sequence
+	ctx.nterm = first_id;
+
+	init_terminals();
+
+	if (!sim_par.get_FadingTrace().empty())
+		con << "Fading trace = "
+		    << ch->open_trace(sim_par.get_FadingTrace(), sim_par.get_MaxSimTime())
+		    << endl;
+
+	start_sim();
+
+	res_struct res = wrap_up();
+
+	if (backoff == VALIDATE) validate_backoff(first_id, res);
+
+#ifdef _PROFILE_
+	_this_profiler_.add(ctx.profiler);
+#endif
+
+	return res;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Iteration::init_terminals                                                  //
 //                                                                            //
 // initializes terminals for a new iteration                                  //
 ////////////////////////////////////////////////////////////////////////////////
-void Simulation::init_terminals(){
+void Iteration::init_terminals(){
 
 	adapt_struct adapt (sim_par.get_TxMode(), sim_par.get_AdaptMode(),
 			sim_par.get_TxPowerMax(), sim_par.get_TxPowerMin(),
@@ -370,9 +586,17 @@ void Simulation::init_terminals(){
 
 	for (unsigned i = 0; i < sim_par.get_NumberAPs(); i++) {
 		AccessPoint* ap = new AccessPoint(sim_par.get_APPosition(i), &main_sch, ch,
-				&randgent, &log, mac, phy, tr_time);
+				&randgent, &ctx, &log, mac, phy, tr_time);
 		term_vector.push_back(ap);
 
+		// one analytic backoff per BSS, channel occupation sensed at the AP
+		if (backoff != EVENT_DRIVEN) {
+			domains.push_back(new Contention(&main_sch, &ctx, ap->get_phy(),
+					sim_par.get_CCASensitivity()));
+			ch->contention_request(domains.back());
+			ap->get_mac()->set_contention(domains.back());
+		}
+
 		if (log(log_type::setup))
 			log << *ap << " created at position " << sim_par.get_APPosition(i)
 			<< '\n' << endl;
@@ -433,7 +657,7 @@ void Simulation::init_terminals(){
 		}
 
 		MobileStation* ms = new MobileStation(pos, &main_sch, ch, &randgent,
-				&log, mac, phy, tr_time);
+				&ctx, &log, mac, phy, tr_time);
 		term_vector.push_back(ms);
 
 		double min_dist = HUGE_VAL;
@@ -460,6 +684,7 @@ void Simulation::init_terminals(){
 
 		// Connect mobile terminal to closest AP
 		connect_two(term_vector[min_index], AP_AC, ms, MS_AC, ch, adapt, tr_dl, tr_ul);
+		if (backoff != EVENT_DRIVEN) ms->get_mac()->set_contention(domains[min_index]);
 
 		if (log(log_type::setup))
 			log << *ms << " created at position " << pos << " with distance "
@@ -473,11 +698,11 @@ void Simulation::init_terminals(){
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Simulation::log_connections                                                //
+// Iteration::log_connections                                                 //
 //                                                                            //
 // saves all active communication links to log file                           //
 ////////////////////////////////////////////////////////////////////////////////
-void Simulation::log_connections () {
+void Iteration::log_connections () {
 
 	log << '\n';
 	for (vector<Terminal*>::const_iterator it = term_vector.begin();
@@ -489,95 +714,48 @@ void Simulation::log_connections () {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Simulation::run                                                            //
-//                                                                            //
-// starts all simulations, iterates over all parameter combinations           //
-////////////////////////////////////////////////////////////////////////////////
-void Simulation::run() {
-	int n_it = 0;
-
-	do {
-		n_it++;
-
-		if(sim_par.get_partResults()) {
-			out << "\n\nIteration " << n_it << "\n    " << sim_par << "\n" << endl;
-		}
-		cout << "\n\nIteration " << n_it << "\n    " << sim_par << "\n" << endl;
-
-		if (log(log_type::setup))
-			log << "\n\nIteration " << n_it << "\n\t" << sim_par << "\n"
-			<< endl;
-
-		/*
-#ifdef _SAVE_RATE_ADAPT
-    rate_adapt_file_ch << "\n\nIteration " << n_it << "\n\t" << sim_par << "\n"
-                       << "Time      ,term 1,term 2,path loss ,"
-                       << "fading(R) ,fading(I)\n";
-    rate_adapt_file_ch.setf(ios::left);
-    rate_adapt_file_rt << "\n\nIteration " << n_it << "\n\t" << sim_par << "\n"
-                       << "Time      ,sender,target,data rate\n";
-    rate_adapt_file_rt.setf(ios::left);
-#endif
-		 */
-		main_sch.init();
-
-		randgent.seed(sim_par.get_Seed());
-
-		Standard::set_standard(sim_par.get_standard(),sim_par.get_bandwidth(),
-				sim_par.get_shortGI());
-		if(sim_par.get_TxMode() > Standard::get_maxMCS())
-			throw (my_exception("MCS not supported by standard."));
-
-		channel_struct ch_par(sim_par.get_LossExponent(),
-				sim_par.get_RefLoss(),
-				sim_par.get_DopplerSpread(),
-				sim_par.get_NumberSinus(),
-				sim_par.get_channelModel());
-
-		ch = new Channel(&main_sch, &randgent, ch_par, &log);
-
-		init_terminals();
-
-		start_sim();
-
-		wrap_up();
-
-		delete ch;
-		for (vector<Terminal*>::iterator it = term_vector.begin();
-				it != term_vector.end(); ++it) delete *it;
-		term_vector.clear();
-
-	} while (sim_par.new_iteration());
-
-	final_results();
-}
-
-
-////////////////////////////////////////////////////////////////////////////////
-// Simulation::start_sim                                                      //
+// Iteration::start_sim                                                       //
 //                                                                            //
 // starts a new iteration                                                     //
 ////////////////////////////////////////////////////////////////////////////////
-void Simulation::start_sim () {
-	// schedule temporary outputs
-	main_sch.schedule(Event(timestamp(sim_par.get_TempOutputInterval()),
-			(void*)&wrapper_to_temp_output,(void*)this));
+void Iteration::start_sim () {
+	// schedule temporary outputs, after all other events at the same time
+	main_sch.schedule(Event::callback<Iteration, &Iteration::temp_output>(
+			timestamp(sim_par.get_TempOutputInterval()), this)
+			.set_priority(PRIO_LOW));
 
 	// start scheduler
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
 	main_sch.run(sim_par.get_MaxSimTime());
+	chrono::duration<double> t = chrono::steady_clock::now() - t0;
+
+	// scheduler performance, e.g. to compare event queue types
+	con << "Events processed = " << main_sch.n_processed();
+	if (t.count() > 0)
+		con << " (" << main_sch.n_processed() / t.count() << " events/sec.)";
+	con << endl;
+
+	// fading updates avoided within the coherence time of the links
+	unsigned long hits = ch->get_fade_hits(), updates = ch->get_fade_updates();
+	con << "Fading updates = " << updates;
+	if (hits + updates > 0)
+		con << " (" << 100.0 * hits / (hits + updates)
+		    << "% of requests without update)";
+	con << endl;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
-// Simulation::temp_output                                                    //
+// Iteration::temp_output                                                     //
 //                                                                            //
 // displays results in standard output during simulation                      //
 ////////////////////////////////////////////////////////////////////////////////
-void Simulation::temp_output () {
+void Iteration::temp_output () {
 	// schedule new temporary output
-	main_sch.schedule(Event(main_sch.now() + sim_par.get_TempOutputInterval(),
-			(void*)&wrapper_to_temp_output,(void*)this));
+	main_sch.schedule(Event::callback<Iteration, &Iteration::temp_output>(
+			main_sch.now() + sim_par.get_TempOutputInterval(), this)
+			.set_priority(PRIO_LOW));
 
-	cout << "Simulation time ellapsed = " << main_sch.now() << " sec. \n";
+	con << "Simulation time ellapsed = " << main_sch.now() << " sec. \n";
 
 	double sim_time = double(main_sch.now());
 	double tr_time = double(sim_par.get_TransientTime());
@@ -587,22 +765,17 @@ void Simulation::temp_output () {
 				it != term_vector.end(); ++it) {
 			total_tp += (*it)->get_n_bytes()*8.0/(sim_time-tr_time)/1e6;
 		}
-		cout << "\tTotal throughput = " << total_tp << endl;
+		con << "\tTotal throughput = " << total_tp << endl;
 	}
 }
 
-void Simulation::wrapper_to_temp_output (void* ptr2obj) {
-	Simulation* which = (Simulation*) ptr2obj;
-	which->temp_output();
-}
-
 ////////////////////////////////////////////////////////////////////////////////
-// Simulation::wrap_up                                                        //
+// Iteration::wrap_up                                                         //
 //                                                                            //
 // ends one iteration and collect performance results,                        //
 // outputs them if required (if 'it_file_flag == true')                       //
 ////////////////////////////////////////////////////////////////////////////////
-void Simulation::wrap_up () {
+res_struct Iteration::wrap_up () {
 
 	res_stats res;
 
@@ -613,7 +786,7 @@ void Simulation::wrap_up () {
 
 	if(sim_par.get_partResults()) {
 		out.setf(ios::right | ios::fixed);
-		out << Standard::get_standard() << endl;
+		out << ctx.standard.get_standard() << endl;
 		out << "Term Position   dist.  AC     throughput transfer_t tx_time packets"
 				<< " kbytes pack_loss overflow queue_l tx_rate(PHY) tx_power" << endl;
 		out << "        m        m      Mbps         ms      ms           "
@@ -673,22 +846,51 @@ void Simulation::wrap_up () {
 			res.average_power.mean());
 	if(sim_par.get_partResults()) {
 		out << "\n Total throughput = " << restotal.throughput << " Mbps\n";
-		cout << "\nTotal throughput = " << restotal.throughput << " Mbps\n";
+		con << "\nTotal throughput = " << restotal.throughput << " Mbps\n";
 
 		out << " Average transfer time = " << restotal.transfer_time << "s\n";
-		cout << "\nAverage transfer time = " << restotal.transfer_time << "s\n";
+		con << "\nAverage transfer time = " << restotal.transfer_time << "s\n";
 
 		out << " Average transmission time = " << restotal.tx_time << "s\n";
-		cout << "\nAverage transmission time = " << restotal.tx_time << "s\n";
+		con << "\nAverage transmission time = " << restotal.tx_time << "s\n";
 
 		out << " Packet loss rate = " << restotal.packet_loss_rate << "\n";
-		cout << "\nPacket loss rate = " << restotal.packet_loss_rate << "\n";
+		con << "\nPacket loss rate = " << restotal.packet_loss_rate << "\n";
 
 		out << " Overflow rate = " << restotal.overflow_rate << "\n";
-		cout << "\nOverflow rate = " << restotal.overflow_rate << "\n";
+		con << "\nOverflow rate = " << restotal.overflow_rate << "\n";
 	}
 
-	results.push_back(restotal);
+	return restotal;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// Iteration::validate_backoff                                                //
+//                                                                            //
+// repeats this iteration with the event-driven backoff countdown (same seed  //
+// and terminal numbers, outputs discarded) and compares its throughput and   //
+// number of events with the ones of the analytic backoff                     //
+////////////////////////////////////////////////////////////////////////////////
+void Iteration::validate_backoff(unsigned first_id, const res_struct& res) {
+
+	ostringstream ref_out, ref_con;
+	Iteration ref(sim_par, n_it, log, ref_out, ref_con);
+	ref.backoff = EVENT_DRIVEN;
+	res_struct ref_res = ref.run(first_id);
+
+	double diff = 0;
+	if (ref_res.throughput > 0)
+		diff = 100.0 * (res.throughput - ref_res.throughput) / ref_res.throughput;
+
+	ostringstream os;
+	os << "\nBackoff validation: throughput = " << res.throughput
+	   << " Mbps (analytic), " << ref_res.throughput
+	   << " Mbps (event-driven), difference = " << diff << " %"
+	   << "\n    events processed = " << main_sch.n_processed()
+	   << " (analytic), " << ref.main_sch.n_processed() << " (event-driven)"
+	   << endl;
+
+	out << os.str();
+	con << os.str();
+}
 
@@ -24,15 +24,20 @@
 #define _Simulation_h 1
 
 #include <string>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
 
 #include "Parameters.h"
 #include "Scheduler.h"
 #include "random.h"
 #include "Channel.h"
+#include "Contention.h"
 #include "Terminal.h"
 #include "log.h"
 #include "DataStatistics.h"
-#include "Standard.h"
+#include "SimContext.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 // struct res_struct                                                          //
@@ -65,19 +70,93 @@ res_struct ( double tp, double tr, double trstd, double tx, double txstd,
 
 };
 
+////////////////////////////////////////////////////////////////////////////////
+// class Iteration                                                            //
+//                                                                            //
+// simulates one parameter combination (including seed)                       //
+//                                                                            //
+// Each object owns its scheduler, random number generator, simulation        //
+// context, channel and terminals, so that different iterations may run in    //
+// parallel threads.                                                          //
+// Outputs are written to streams 'o' (results file) and 'c' (console), which //
+// may be buffers if the iteration does not run in the main thread.           //
+////////////////////////////////////////////////////////////////////////////////
+class Iteration {
+private:
+  Parameters& sim_par;
+  Scheduler main_sch;
+  random randgent;
+  SimContext ctx;
+  Channel* ch;
+
+  vector<Terminal*> term_vector;
+
+  backoff_type backoff;         // engine of the backoff countdown
+  vector<Contention*> domains;  // analytic backoff of each BSS, by AP
+
+  log_file& log;
+  ostream& out;  // results file
+  ostream& con;  // console output
+
+  unsigned n_it; // iteration number
+
+  void init_terminals(); // initialize terminals for this iteration
+
+  void log_connections(); // output all active communication links
+
+  void start_sim(); // start scheduler
+
+  void temp_output(); // display results in standard output during simulation
+  res_struct wrap_up(); // end iteration and collect performance results,
+                        // output them if required (if 'partResults == true')
+
+  void validate_backoff(unsigned first_id, const res_struct& res);
+  // repeats iteration with event-driven backoff and outputs the difference
+  // to results 'res' of the analytic backoff
+
+public:
+  Iteration(Parameters& p,  // parameters, already set to this iteration
+            unsigned n,     // iteration number (starting with 1)
+            log_file& l,    // log file
+            ostream& o,     // results file
+            ostream& c      // console output
+           );
+  ~Iteration();
+
+  res_struct run(unsigned first_id);
+  // simulates iteration and returns its results. Terminals are numbered
+  // starting with 'first_id'.
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// struct sweep_job                                                           //
+//                                                                            //
+// one iteration of a parallel parameter sweep and its buffered outputs       //
+////////////////////////////////////////////////////////////////////////////////
+struct sweep_job {
+  unsigned first_id;   // identification number of first terminal
+  bool done;           // true if iteration was already simulated
+  string out_str;      // buffered output to results file
+  string con_str;      // buffered output to console
+  res_struct res;      // iteration results
+  exception_ptr error; // exception thrown by iteration, if any
+
+  sweep_job(unsigned id) : first_id(id), done(false) {}
+};
+
 ////////////////////////////////////////////////////////////////////////////////
 // class Simulation                                                           //
 //                                                                            //
 // controls the simulation iterations and outputs the results                 //
+//                                                                            //
+// All iterations are listed before the simulation starts and are distributed //
+// among 'Threads' worker threads (see config.txt). Results and outputs are   //
+// collected in the original iteration order, such that the results file is   //
+// identical to the one obtained by a serial simulation.                      //
 ////////////////////////////////////////////////////////////////////////////////
 class Simulation {
 private:
   Parameters sim_par; 
-  Scheduler main_sch; 
-  random randgent;
-  Channel* ch;
-  
-  vector<Terminal*> term_vector;
 
   log_file log;
 
@@ -86,26 +165,25 @@ private:
   
   vector<res_struct> results;   // simulation results
 
+  //////////////////////////
+  // parallel sweep control
+  vector<sweep_job> jobs;
+  atomic<unsigned> next_job;  // next iteration to be simulated
+  atomic<bool> abort_flag;    // true if an iteration has failed
+  mutex job_mutex;
+  condition_variable job_done;
 
-  
   void final_results();  // stop simulation and output results
-  void init_terminals(); // initialize terminals for a new iteration
 
-  void log_connections(); // output all active communication links
-
-  void run();       // start all simulations
-  void start_sim(); // start a new iteration
-
-  void temp_output(); // display results in standard output during simulation
-  void wrap_up();     // end one iteration and collect performance results
-                      // output them if required (if 'it_file_flag == true')
+  void run();          // start all simulations
+  void run_serial();   // simulate all iterations in the main thread
+  void run_parallel(unsigned n_threads); // simulate with worker threads
+  void worker();       // simulate iterations until all jobs are taken
 
 public:
   Simulation(string dir,      // working directory
              string par = ""  // command-line parameters
             );
-
-  static void wrapper_to_temp_output(void* ptr2obj);
 };
 
 #endif
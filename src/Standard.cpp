@@ -21,6 +21,9 @@
  */
 
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <math.h>
 
 #include "Standard.h"
 #include "Packet.h"
@@ -29,19 +32,6 @@
 #include "Channel.h"
 
 // Static member variables need to be defined outside the class
-dot11_standard Standard::currentStd = dot11;
-transmission_mode Standard::maxMCS = MCS;
-double Standard::symbol_period = 4e-6;
-double Standard::rollof = 0.1875;
-channel_bandwidth Standard::maxBand = MHz;
-channel_bandwidth Standard::band = MHz;
-bool Standard::shortGI = false;
-unsigned Standard::numSubcarriers = 52;
-unsigned Standard::lengthFFT = 64;
-
-//Indexes
-unsigned Standard::sgiIdx = 0;
-unsigned Standard::bandIdx = 0;
 
 //Data rates
 double Standard::rates_a[8]       =  {    6,    9,   12,   18,   24,   36,   48,   52};
@@ -417,10 +407,19 @@ int Standard::num_silent_80 = 14;
 int Standard::num_silent_160 = 28;
 
 
+//////////////////////////
+// Standard constructor //
+//////////////////////////
+Standard::Standard() : currentStd(dot11), maxMCS(MCS), symbol_period(4e-6),
+		rollof(0.1875), maxBand(MHz), numSubcarriers(52), lengthFFT(64),
+		band(MHz), shortGI(false), sgiIdx(0), bandIdx(0), use_per_table(false),
+		thresh_target(-1) {}
+
 //////////////////////////////////
 // Standard setters and getters //
 //////////////////////////////////
-void Standard::set_standard(dot11_standard st, channel_bandwidth bw, bool sgi) {
+void Standard::set_standard(dot11_standard st, channel_bandwidth bw, bool sgi,
+		bool per_tab) {
 	currentStd = st;
 	band = bw;
 
@@ -485,41 +484,303 @@ void Standard::set_standard(dot11_standard st, channel_bandwidth bw, bool sgi) {
 	sgiIdx = 0;
 	if(shortGI) sgiIdx = 1;
 	bandIdx = band - MHz20;
+
+	use_per_table = per_tab;
+	per_tables.clear();
+	if(use_per_table) make_per_tables();
+
+	thresh_target = -1;
+	per_threshs.clear();
+	opt_snr.clear();
+	opt_idx.clear();
 }
 
-dot11_standard Standard::get_standard() {
+dot11_standard Standard::get_standard() const {
 	return currentStd;
 }
-transmission_mode Standard::get_maxMCS(){
+transmission_mode Standard::get_maxMCS() const{
 	return maxMCS;
 }
-double Standard::get_symbol_period(){
+double Standard::get_symbol_period() const{
 	return symbol_period;
 }
-double Standard::get_min_thresh(int idx) {
+double Standard::get_min_thresh(int idx) const {
 	if(currentStd == dot11a) return min_thresh_a[idx];
 	else if(currentStd == dot11n) return min_thresh_n[sgiIdx][bandIdx][idx];
 	else return min_thresh_ac_ah[sgiIdx][bandIdx][idx];
 }
-double Standard::get_max_thresh(int idx) {
+double Standard::get_max_thresh(int idx) const {
 	if(currentStd == dot11a) return max_thresh_a[idx];
 	else if(currentStd == dot11n) return max_thresh_n[sgiIdx][bandIdx][idx];
 	else return max_thresh_ac_ah[sgiIdx][bandIdx][idx];
 }
-double Standard::get_coeff(int idx, int i) {
+double Standard::get_coeff(int idx, int i) const {
 	if(currentStd == dot11a) return coeff_a[idx][i];
 	else if(currentStd == dot11n) return coeff_n[sgiIdx][bandIdx][idx][i];
 	else return coeff_ac_ah[sgiIdx][bandIdx][idx][i];
 }
-double Standard::get_coeff_high(int idx, int i) {
+double Standard::get_coeff_high(int idx, int i) const {
 	if(currentStd == dot11a) return coeff_high_a[idx][i];
 	else if(currentStd == dot11n) return coeff_high_n[sgiIdx][bandIdx][idx][i];
 	else return coeff_high_ac_ah[sgiIdx][bandIdx][idx][i];
 }
-channel_bandwidth Standard::get_band() {
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::per_poly                                                         //
+//                                                                            //
+// returns packet error rate for MCS index 'idx' and SNR 'SNR' dB, given by a //
+// polynomial approximation of log10(PER) x SNR. Below the minimum threshold  //
+// PER = 1, above the maximum threshold a polynomial of order                 //
+// 'n_coeff_high - 1' is used, otherwise a polynomial of order 'n_coeff - 1'. //
+////////////////////////////////////////////////////////////////////////////////
+double Standard::per_poly(int idx, double SNR) const {
+	double per;
+
+	if (SNR < get_min_thresh(idx)) {
+		// if SNR is low, then consider BER = 0.5
+		per = 1;
+
+	} else if (SNR > get_max_thresh(idx)) {
+
+		// if SNR is high then use polynomial of order 'n_coeff_high - 1'
+		double perlog = 0;
+
+		double auxpow = 1.0;
+		for (int i = 0; i < n_coeff_high; i++) {
+			perlog += auxpow * get_coeff_high(idx,i);
+			auxpow = auxpow * SNR;
+		}
+		per = pow(10.0,perlog);
+
+	} else {
+
+		// if SNR is medium then use polynomial of order 'n_coeff - 1'
+		double perlog = 0;
+
+		double auxpow = 1.0;
+		for (int i = 0; i < n_coeff; i++) {
+			perlog += auxpow * get_coeff(idx,i);
+			auxpow = auxpow * SNR;
+		}
+		per = pow(10.0,perlog);
+	}
+	if(per > 1.0) per = 1.0; // Polynomial approximations might hand out a PER greated than one
+
+	return per;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::get_per                                                          //
+//                                                                            //
+// returns packet error rate for MCS index 'idx' and SNR 'SNR' dB, either     //
+// interpolated from the PER table or given by 'per_poly'.                    //
+////////////////////////////////////////////////////////////////////////////////
+double Standard::get_per(int idx, double SNR) const {
+	if (!use_per_table) return per_poly(idx, SNR);
+
+	const per_table& tab = per_tables[idx];
+	if (!(SNR >= tab.snr_min)) return 1;
+
+	double perlog;
+	if (SNR > tab.snr_max) {
+		perlog = 0;
+		double auxpow = 1.0;
+		for (int i = 0; i < n_coeff_high; i++) {
+			perlog += auxpow * tab.high[i];
+			auxpow = auxpow * SNR;
+		}
+	} else {
+		double x = (SNR - tab.snr_min) * tab.inv_step;
+		unsigned k = unsigned(x);
+		if (k >= tab.n_step) k = tab.n_step - 1;
+		const double* p = &tab.log2_per[k];
+		perlog = p[0] + (x - k) * (p[1] - p[0]);
+	}
+
+	double per = exp2(perlog);
+	if(per > 1.0) per = 1.0;
+	return per;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::make_per_tables                                                  //
+//                                                                            //
+// calculates the PER tables of all MCSs. The grid between the thresholds is  //
+// evenly spaced with at most 'per_step' dB.                                  //
+////////////////////////////////////////////////////////////////////////////////
+void Standard::make_per_tables() {
+	const double log2_10 = 3.32192809488736234787;
+
+	per_tables.resize(maxMCS - MCS0 + 1);
+	for (unsigned idx = 0; idx < per_tables.size(); idx++) {
+		per_table& tab = per_tables[idx];
+
+		tab.snr_min = get_min_thresh(idx);
+		tab.snr_max = get_max_thresh(idx);
+		double width = tab.snr_max - tab.snr_min;
+		tab.n_step = unsigned(ceil(width/per_step - 1e-9));
+		if (tab.n_step == 0) tab.n_step = 1;
+		tab.inv_step = (width > 0)? tab.n_step / width : 0;
+
+		tab.log2_per.resize(tab.n_step + 1);
+		for (unsigned k = 0; k <= tab.n_step; k++) {
+			double SNR = (k < tab.n_step)? tab.snr_min + k * width / tab.n_step
+			                             : tab.snr_max;
+			double perlog = 0;
+			double auxpow = 1.0;
+			for (int i = 0; i < n_coeff; i++) {
+				perlog += auxpow * get_coeff(idx,i);
+				auxpow = auxpow * SNR;
+			}
+			tab.log2_per[k] = perlog * log2_10;
+		}
+
+		for (int i = 0; i < n_coeff_high; i++)
+			tab.high[i] = get_coeff_high(idx,i) * log2_10;
+	}
+
+#ifdef _CHECK_PER_TABLE_
+	check_per_tables();
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::check_per_tables                                                 //
+//                                                                            //
+// compares 'get_per' to 'per_poly' for all MCSs at several points within     //
+// each grid interval and throws an exception if the relative error exceeds   //
+// the bound given in Standard.h.                                             //
+////////////////////////////////////////////////////////////////////////////////
+void Standard::check_per_tables() const {
+	for (unsigned idx = 0; idx < per_tables.size(); idx++) {
+		const per_table& tab = per_tables[idx];
+
+		for (double SNR = tab.snr_min - 1; SNR < tab.snr_max + 10;
+				SNR += per_step/7) {
+			double exact = per_poly(idx, SNR);
+			if (fabs(get_per(idx, SNR) - exact) > 1e-3 * exact) {
+				ostringstream os;
+				os << "PER table of MCS" << idx << " exceeds error bound at "
+				   << SNR << "dB";
+				throw (my_exception(GENERAL, os.str()));
+			}
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::per_below                                                        //
+//                                                                            //
+// returns true if the packet error rate for MCS index 'idx' and SNR 'SNR' dB //
+// is not larger than 'per_target', i.e., get_per(idx, SNR) <= per_target.    //
+////////////////////////////////////////////////////////////////////////////////
+bool Standard::per_below(int idx, double SNR, double per_target) {
+	if (per_target != thresh_target) make_per_threshs(per_target);
+
+	bool below = below_thresh(per_threshs[idx], SNR);
+
+#ifdef _CHECK_PER_THRESH_
+	if (below != (get_per(idx, SNR) <= per_target))
+		throw (my_exception(GENERAL, "Standard::per_below differs from PER"));
+#endif
+	return below;
+}
+
+bool Standard::below_thresh(const per_thresh& th, double SNR) {
+	unsigned n = upper_bound(th.snr.begin(), th.snr.end(), SNR) - th.snr.begin();
+	return th.below_min != (n % 2 == 1);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::opt_mcs                                                          //
+//                                                                            //
+// returns the highest MCS with packet error rate not larger than             //
+// 'per_target' at SNR 'SNR' dB, or MCS0 if there is none.                    //
+////////////////////////////////////////////////////////////////////////////////
+transmission_mode Standard::opt_mcs(double SNR, double per_target) {
+	if (per_target != thresh_target) make_per_threshs(per_target);
+
+	unsigned n = upper_bound(opt_snr.begin(), opt_snr.end(), SNR)
+	             - opt_snr.begin();
+	transmission_mode mode = transmission_mode(MCS0 + opt_idx[n]);
+
+#ifdef _CHECK_PER_THRESH_
+	transmission_mode m = maxMCS;
+	while (m != MCS0 && get_per(m - MCS0, SNR) > per_target) --m;
+	if (m != mode)
+		throw (my_exception(GENERAL, "Standard::opt_mcs differs from PER"));
+#endif
+	return mode;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// Standard::make_per_threshs                                                 //
+//                                                                            //
+// finds the SNRs at which get_per(idx, SNR) <= per_target changes for all    //
+// MCSs. Between the thresholds, where the PER polynomial is not monotone,    //
+// the SNR is scanned in steps of 0.001 dB. Above the maximum threshold,      //
+// log(PER) is linear in SNR. Each change is located by bisection down to     //
+// adjacent doubles.                                                          //
+////////////////////////////////////////////////////////////////////////////////
+void Standard::make_per_threshs(double per_target) {
+	const double scan_step = 0.001;
+	const double snr_far = 200;
+
+	thresh_target = per_target;
+	per_threshs.resize(maxMCS - MCS0 + 1);
+	for (unsigned idx = 0; idx < per_threshs.size(); idx++) {
+		per_thresh& th = per_threshs[idx];
+		th.snr.clear();
+
+		double snr_min = get_min_thresh(idx);
+		double snr_max = get_max_thresh(idx);
+		th.below_min = (get_per(idx, -snr_far) <= per_target);
+
+		// points at which the PER is evaluated, in ascending order
+		vector<double> pts(1, -snr_far);
+		for (unsigned k = 0; snr_min + k * scan_step < snr_max; k++)
+			pts.push_back(snr_min + k * scan_step);
+		pts.push_back(snr_max);
+		pts.push_back(nextafter(snr_max, HUGE_VAL));
+		pts.push_back(snr_max + snr_far);
+
+		bool below = th.below_min;
+		for (unsigned k = 1; k < pts.size(); k++) {
+			double hi = pts[k];
+			if ((get_per(idx, hi) <= per_target) == below) continue;
+
+			double lo = pts[k-1];
+			for (;;) {
+				double mid = lo + (hi - lo) / 2;
+				if (mid <= lo || mid >= hi) break;
+				if ((get_per(idx, mid) <= per_target) == below) lo = mid;
+				else hi = mid;
+			}
+			th.snr.push_back(hi);
+			below = !below;
+		}
+	}
+
+	opt_snr.clear();
+	for (unsigned idx = 0; idx < per_threshs.size(); idx++)
+		opt_snr.insert(opt_snr.end(), per_threshs[idx].snr.begin(),
+		               per_threshs[idx].snr.end());
+	sort(opt_snr.begin(), opt_snr.end());
+	opt_snr.erase(unique(opt_snr.begin(), opt_snr.end()), opt_snr.end());
+
+	opt_idx.resize(opt_snr.size() + 1);
+	for (unsigned k = 0; k < opt_idx.size(); k++) {
+		double SNR = (k == 0)? -HUGE_VAL : opt_snr[k-1];
+		unsigned idx = per_threshs.size() - 1;
+		while (idx > 0 && !below_thresh(per_threshs[idx], SNR)) idx--;
+		opt_idx[k] = idx;
+	}
+}
+
+channel_bandwidth Standard::get_band() const {
 	return band;
 }
-double Standard::get_band_double(){
+double Standard::get_band_double() const{
 	switch(band) {
 	case MHz20: return 20e6;
 	case MHz40: return 40e6;
@@ -528,19 +789,19 @@ double Standard::get_band_double(){
 	default: return 0;
 	}
 }
-double Standard::get_rollof() {
+double Standard::get_rollof() const {
 	return rollof;
 }
-channel_bandwidth Standard::get_maxBand() {
+channel_bandwidth Standard::get_maxBand() const {
 	return maxBand;
 }
-unsigned Standard::get_numSubcarriers()	{
+unsigned Standard::get_numSubcarriers() const	{
 	return numSubcarriers;
 }
-unsigned Standard::get_lengthFFT(){
+unsigned Standard::get_lengthFFT() const{
 	return lengthFFT;
 }
-double Standard::get_beta(transmission_mode tm, channel_model cm) {
+double Standard::get_beta(transmission_mode tm, channel_model cm) const {
 
 	unsigned mcsIdx = tm - MCS0;
 	unsigned cmIdx = cm - A;
@@ -557,7 +818,7 @@ double Standard::get_beta(transmission_mode tm, channel_model cm) {
 ///////////////////////
 // tx_mode_to_double //
 ///////////////////////
-double Standard::tx_mode_to_double (transmission_mode tm) {
+double Standard::tx_mode_to_double (transmission_mode tm) const {
 
 	unsigned mode = tm - MCS0;
 
@@ -574,7 +835,7 @@ double Standard::tx_mode_to_double (transmission_mode tm) {
 ////////////////////////////
 // txMode_bits_per_symbol //
 ////////////////////////////
-unsigned Standard::txMode_bits_per_symbol(transmission_mode tm) {
+unsigned Standard::txMode_bits_per_symbol(transmission_mode tm) const {
 
 	unsigned mode = tm - MCS0;
 
@@ -588,7 +849,7 @@ unsigned Standard::txMode_bits_per_symbol(transmission_mode tm) {
 	return 0;
 }
 
-bool Standard::is_silent(int carr) {
+bool Standard::is_silent(int carr) const {
 	if(currentStd == dot11a){
 		for(int k = 0; k < num_silent_20_a; k++) {
 			if(silent_20_a[k] == carr) return true;
@@ -24,6 +24,7 @@
 #define STANDARD_H_ 1
 
 #include <iostream>
+#include <vector>
 
 #include "Packet.h"
 #include "Channel.h"
@@ -35,6 +36,7 @@ using namespace std;
 ////////////////////////////////////////////////////////////////////////////////
 const int n_coeff = 5;
 const int n_coeff_high = 2;
+const double per_step = 0.01; // maximum SNR step of PER table in dB
 
 ////////////////////////////////////////////////////////////////////////////////
 // Standard to be simulated
@@ -63,21 +65,44 @@ istream& operator>> (istream& is, channel_bandwidth& st);
 
 ////////////////////////////////////////////////////////////////////////////////
 // class Standard                                                             //
+//                                                                            //
+// configuration of the simulated IEEE 802.11 standard                        //
+//                                                                            //
+// Each simulation has its own Standard object (see SimContext.h), which is   //
+// configured with 'set_standard' at the beginning of the simulation. The     //
+// coefficient tables are constant and shared by all objects.                 //
+//                                                                            //
+// The packet error rate is given by the polynomial approximation of          //
+// log10(PER) x SNR ('per_poly'). If 'per_tab' is set in 'set_standard',      //
+// log2(PER) is calculated once for all MCSs on a grid of at most 'per_step'  //
+// dB between the thresholds, and 'get_per' interpolates linearly. Above the  //
+// maximum threshold, log2(PER) is linear in SNR and no table is needed. The  //
+// relative error of the interpolated PER is below 1e-3. If _CHECK_PER_TABLE_ //
+// is defined, the table is compared to the polynomial and an exception is    //
+// thrown if this bound is exceeded.                                          //
+//                                                                            //
+// 'per_below' decides whether the PER is at most a target value by a binary  //
+// search in the SNRs at which this condition changes. These SNRs are         //
+// calculated once for each target value. Since the PER approximations are    //
+// not strictly monotone, there may be several of them for an MCS. 'opt_mcs'  //
+// returns the highest MCS satisfying the target by a single binary search in //
+// the union of these SNRs. If _CHECK_PER_THRESH_ is defined, the results are //
+// compared to 'get_per'.                                                     //
 ////////////////////////////////////////////////////////////////////////////////
 class Standard {
 private:
 	// Standard prameters
-	static dot11_standard currentStd;
-	static transmission_mode maxMCS;
-	static double symbol_period;      //OFDM symbol period
-	static double rollof;
-	static channel_bandwidth maxBand;
-	static unsigned numSubcarriers;		// Number of OFDM data subcarriers
-	static unsigned lengthFFT;			// Length of OFDM fft
+	dot11_standard currentStd;
+	transmission_mode maxMCS;
+	double symbol_period;      //OFDM symbol period
+	double rollof;
+	channel_bandwidth maxBand;
+	unsigned numSubcarriers;		// Number of OFDM data subcarriers
+	unsigned lengthFFT;			// Length of OFDM fft
 
 	// Flags and holders
-	static channel_bandwidth band;
-	static bool shortGI;
+	channel_bandwidth band;
+	bool shortGI;
 
 	// The first dimension corresponds the channel model, the second to the guard interval,
 	// the third to the MCS and the fourth to the bandwidth
@@ -125,30 +150,65 @@ private:
 	static double coeff_high_ac_ah[2][4][10][2];
 
 	// Indexes
-	static unsigned sgiIdx;
-	static unsigned bandIdx;
+	unsigned sgiIdx;
+	unsigned bandIdx;
+
+	// PER lookup table for each MCS
+	struct per_table {
+		double snr_min; // minimum threshold, PER = 1 below
+		double snr_max; // maximum threshold
+		double inv_step; // inverse grid step
+		unsigned n_step; // number of grid intervals
+		vector<double> log2_per; // log2(PER) at n_step + 1 grid points
+		double high[n_coeff_high]; // coefficients of log2(PER) above snr_max
+	};
+	bool use_per_table;
+	vector<per_table> per_tables;
+
+	// SNRs at which PER <= 'thresh_target' changes for each MCS
+	struct per_thresh {
+		bool below_min; // PER <= target below the first SNR in 'snr'
+		vector<double> snr; // in ascending order
+	};
+	double thresh_target;
+	vector<per_thresh> per_threshs;
+	vector<double> opt_snr; // SNRs at which 'opt_mcs' changes, ascending
+	vector<unsigned> opt_idx; // MCS index below and above each of them
+
+	static bool below_thresh(const per_thresh& th, double SNR);
+
+	void make_per_tables();
+	void check_per_tables() const;
+	void make_per_threshs(double per_target);
 
 public:
-	static void set_standard(dot11_standard st, channel_bandwidth bw, bool sgi);
-	static dot11_standard get_standard();
-	static transmission_mode get_maxMCS();
-	static double get_symbol_period();
-	static double get_min_thresh(int idx);
-	static double get_max_thresh(int idx);
-	static double get_coeff(int idx, int i);
-	static double get_coeff_high(int idx, int i);
-	static channel_bandwidth get_band();
-	static double get_band_double();
-	static double get_rollof();
-	static channel_bandwidth get_maxBand();
-	static unsigned get_numSubcarriers();
-	static unsigned get_lengthFFT();
-	static double get_beta(transmission_mode tm, channel_model cm);
-
-	static double tx_mode_to_double(transmission_mode tm);
-	static unsigned txMode_bits_per_symbol(transmission_mode tm);
-
-	static bool is_silent(int carr);
+	Standard();
+
+	void set_standard(dot11_standard st, channel_bandwidth bw, bool sgi,
+			bool per_tab);
+	dot11_standard get_standard() const;
+	transmission_mode get_maxMCS() const;
+	double get_symbol_period() const;
+	double get_min_thresh(int idx) const;
+	double get_max_thresh(int idx) const;
+	double get_coeff(int idx, int i) const;
+	double get_coeff_high(int idx, int i) const;
+	double per_poly(int idx, double SNR) const;
+	double get_per(int idx, double SNR) const;
+	bool per_below(int idx, double SNR, double per_target);
+	transmission_mode opt_mcs(double SNR, double per_target);
+	channel_bandwidth get_band() const;
+	double get_band_double() const;
+	double get_rollof() const;
+	channel_bandwidth get_maxBand() const;
+	unsigned get_numSubcarriers() const;
+	unsigned get_lengthFFT() const;
+	double get_beta(transmission_mode tm, channel_model cm) const;
+
+	double tx_mode_to_double(transmission_mode tm) const;
+	unsigned txMode_bits_per_symbol(transmission_mode tm) const;
+
+	bool is_silent(int carr) const;
 };
 
 #endif /* STANDARD_H_ */
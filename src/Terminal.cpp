@@ -28,6 +28,7 @@
 #include "Terminal.h"
 #include "Packet.h"
 #include "Profiler.h"
+#include "SimContext.h"
 #include "timestamp.h"
 #include "math.h"
 #include "myexception.h"
@@ -38,26 +39,26 @@
 // abstract class Terminal                                                    //
 ////////////////////////////////////////////////////////////////////////////////
 
-unsigned Terminal_private::nterm = 0;
-
 ////////////////////////////////////////////////////////////////////////////////
 // Terminal constructor                                                       //
 ////////////////////////////////////////////////////////////////////////////////
-Terminal::Terminal(Position p, Scheduler* s, Channel* c, random* r, log_file* l,
-                   mac_struct mac, PHY_struct phy, timestamp transient) {
+Terminal::Terminal(Position p, Scheduler* s, Channel* c, random* r,
+                   SimContext* x, log_file* l, mac_struct mac, PHY_struct phy,
+                   timestamp transient) {
 
   where = p;
   
   ptr2sch = s;
   randgen = r;
+  ctx = x;
   mylog = l;
   
   transient_time = transient;
   
-  id = nterm++;
+  id = ctx->nterm++;
   
-  myphy = new PHY(this, p, c, r, s, l, phy);
-  mymac = new MAC(this, s, r, l, mac);
+  myphy = new PHY(this, p, c, r, s, ctx, l, phy);
+  mymac = new MAC(this, s, r, ctx, l, mac);
 
   myphy->connect(mymac);
   mymac->connect(myphy);
@@ -282,8 +283,8 @@ void MobileStation::connect(Terminal* t, adapt_struct ad, traffic_struct ts, acc
 
   connected = make_pair(t,AC);
 
-  tr = new Traffic(ptr2sch, randgen, mylog, this, t, ts);
-  la = link_adapt(this, t, ad, mylog);
+  tr = new Traffic(ptr2sch, randgen, ctx, mylog, this, t, ts);
+  la = link_adapt(this, t, ad, ctx, mylog);
   
 }
 
@@ -342,9 +343,8 @@ string MobileStation::str() const {
 // AccessPoint destructor                                                     //
 ////////////////////////////////////////////////////////////////////////////////
 AccessPoint::~AccessPoint() {
-  for (
-  map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::iterator it = connection.begin();
-  it != connection.end(); ++it) {
+  for (connection_map::iterator it = connection.begin();
+       it != connection.end(); ++it) {
     delete get<1>(it->second);
   }
 }
@@ -356,8 +356,8 @@ AccessPoint::~AccessPoint() {
 ////////////////////////////////////////////////////////////////////////////////
 void AccessPoint::connect(Terminal* t, adapt_struct ad, traffic_struct ts, accCat AC) {
 
-  Traffic* tr = new Traffic(ptr2sch, randgen, mylog, this, t, ts);
-  connection[t] = make_tuple(link_adapt(this,t,ad, mylog), tr, AC);
+  Traffic* tr = new Traffic(ptr2sch, randgen, ctx, mylog, this, t, ts);
+  connection[t] = make_tuple(link_adapt(this,t,ad, ctx, mylog), tr, AC);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -366,8 +366,7 @@ void AccessPoint::connect(Terminal* t, adapt_struct ad, traffic_struct ts, accCa
 // returns string with ACs of all connections                                 //
 ////////////////////////////////////////////////////////////////////////////////
 string AccessPoint::get_term_ACs() {
-	map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::const_iterator it =
-			connection.begin();
+	connection_map::const_iterator it = connection.begin();
 	string s = "";
 	s += get<2>(it++->second);
 
@@ -385,12 +384,10 @@ string AccessPoint::get_term_ACs() {
 ////////////////////////////////////////////////////////////////////////////////
 string AccessPoint::get_connections() const {
 
-  map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::const_iterator it =
-                                                             connection.begin();
+  connection_map::const_iterator it = connection.begin();
   string s = (it++->first)->str();
 
-  map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::const_iterator it_aux =
-                                                               connection.end();
+  connection_map::const_iterator it_aux = connection.end();
   it_aux--;
                                                                  
   for (; it != connection.end(); ++it) {
@@ -410,8 +407,7 @@ string AccessPoint::get_connections() const {
 // connection does not exist then an exception is thrown.					  //
 ////////////////////////////////////////////////////////////////////////////////
 accCat AccessPoint::get_connection_AC(Terminal* t) {
-	map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::const_iterator it =
-			connection.find(t);
+	connection_map::const_iterator it = connection.find(t);
 	if (it == connection.end())
 		throw(my_exception(GENERAL,
 				"unknown terminal in AccessPoint::get_connection_AC"));
@@ -423,7 +419,7 @@ accCat AccessPoint::get_connection_AC(Terminal* t) {
 // AccessPoint::get_current_mode                                              //
 ////////////////////////////////////////////////////////////////////////////////
 transmission_mode AccessPoint::get_current_mode(Terminal* t,unsigned pl) {
-  map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::iterator it = connection.find(t);
+  connection_map::iterator it = connection.find(t);
   if (it == connection.end())
     throw(my_exception(GENERAL,
                        "unknown terminal in AccessPoint::get_current_mode"));
@@ -435,7 +431,7 @@ transmission_mode AccessPoint::get_current_mode(Terminal* t,unsigned pl) {
 // AccessPoint::get_power                                                     //
 ////////////////////////////////////////////////////////////////////////////////
 double AccessPoint::get_power(Terminal* t, unsigned pl) {
-  map<Terminal*, tuple<link_adapt, Traffic*, accCat> >::iterator it = connection.find(t);
+  connection_map::iterator it = connection.find(t);
   if (it == connection.end())
     throw(my_exception(GENERAL,
                        "unknown terminal in AccessPoint::get_current_mode"));
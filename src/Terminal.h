@@ -52,6 +52,7 @@ public:
            Scheduler* s,          // pointer to simulation scheduler
            Channel* c,            // pointer to wireless channel
            random* r,             // pointer to random number generator
+           SimContext* x,         // pointer to simulation context
            log_file* l,           // pointer to log file
            mac_struct mac,        // MAC layer parameters
            PHY_struct phy,        // physical layer parameters
@@ -155,6 +156,17 @@ public:
 
 ostream& operator<< (ostream& os, const Terminal& t);
 
+////////////////////////////////////////////////////////////////////////////////
+// struct term_id_less                                                        //
+//                                                                            //
+// orders terminals by identification number, so that containers of terminal  //
+// pointers do not depend on memory addresses                                 //
+////////////////////////////////////////////////////////////////////////////////
+struct term_id_less {
+  bool operator() (const Terminal* t1, const Terminal* t2) const {
+    return t1->get_id() < t2->get_id();}
+};
+
 
 ////////////////////////////////////////////////////////////////////////////////
 // class MobileStation                                                        //
@@ -171,9 +183,9 @@ class MobileStation : public Terminal {
   // using link adaptation parameters 'ad' and traffic parameters 'ts'
 
 public:
-  MobileStation(Position p, Scheduler* s, Channel* c, random* r, log_file* l,
-		  mac_struct mac, PHY_struct phy, timestamp tr)
-			: Terminal(p, s, c, r, l, mac, phy, tr) {connected = make_pair(this,AC_BK);};
+  MobileStation(Position p, Scheduler* s, Channel* c, random* r, SimContext* x,
+		  log_file* l, mac_struct mac, PHY_struct phy, timestamp tr)
+			: Terminal(p, s, c, r, x, l, mac, phy, tr) {connected = make_pair(this,AC_BK);};
   ~MobileStation();
   
   accCat get_connection_AC(Terminal* t);
@@ -205,7 +217,10 @@ public:
 // an AccessPoint is a Terminal with several possible connections             //
 ////////////////////////////////////////////////////////////////////////////////
 class AccessPoint : public Terminal {
-  map<Terminal*, tuple<link_adapt, Traffic*, accCat> >connection;
+  typedef map<Terminal*, tuple<link_adapt, Traffic*, accCat>, term_id_less>
+          connection_map;
+
+  connection_map connection;
   // link adaptation units and traffic generators for each connection
   
   void connect(Terminal* t, adapt_struct ad, traffic_struct ts, accCat AC);
@@ -213,9 +228,9 @@ class AccessPoint : public Terminal {
   // using link adaptation parameters 'ad' and traffic parameters 'ts'
 
 public:
-  AccessPoint(Position p, Scheduler* s, Channel* c, random* r, log_file* l,
-              mac_struct mac, PHY_struct phy, timestamp tr)
-             : Terminal(p, s, c, r, l, mac, phy, tr) {};
+  AccessPoint(Position p, Scheduler* s, Channel* c, random* r, SimContext* x,
+              log_file* l, mac_struct mac, PHY_struct phy, timestamp tr)
+             : Terminal(p, s, c, r, x, l, mac, phy, tr) {};
   ~AccessPoint();
 
   accCat get_connection_AC(Terminal* t);
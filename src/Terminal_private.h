@@ -41,6 +41,8 @@
 #include "log.h"
 #include "Traffic.h"
 
+class SimContext;
+
 ////////////////////////////////////////////////////////////////////////////////
 // class Terminal_private                                                     //
 //                                                                            //
@@ -50,6 +52,7 @@ class Terminal_private{
 protected:
 	Scheduler* ptr2sch; // pointer to simulation scheduler
 	random*    randgen; // pointer to random number generator
+	SimContext* ctx;    // pointer to simulation context
 	log_file*  mylog;   // pointer to log file
 	timestamp  transient_time; // collect results only after transient_time
 
@@ -59,7 +62,6 @@ protected:
 
 	Position where; // terminal location
 	unsigned id;    // unique identification number
-	static unsigned nterm; // total number of instanciated terminals
 
 	/////////////////////////////
 	// performance measurements
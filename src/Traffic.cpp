@@ -26,6 +26,7 @@
 #include "Packet.h"
 #include "myexception.h"
 #include "Profiler.h"
+#include "SimContext.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 ////////////////////////////////////////////////////////////////////////////////
@@ -185,11 +186,12 @@ int discrete_prob::new_value(double randval) const {
 ////////////////////////////////////////////////////////////////////////////////
 // Traffic constructor                                                       //
 ////////////////////////////////////////////////////////////////////////////////
-Traffic::Traffic(Scheduler* s, random* r, log_file* l,
+Traffic::Traffic(Scheduler* s, random* r, SimContext* x, log_file* l,
                  Terminal* from, Terminal* to, traffic_struct tr) {
 
   ptr2sch = s;
   randgen = r;
+  ctx = x;
 
   mylog = l;
   logflag = (*mylog)(log_type::traffic);
@@ -218,8 +220,8 @@ Traffic::Traffic(Scheduler* s, random* r, log_file* l,
     if (logflag) *mylog << *source << " generates first packet at " 
                         << time_arrival << "secs" << endl;
 
-    ptr2sch->schedule(Event(time_arrival, (void*)(&wrapper_to_new_packet),
-                            (void*)this));
+    ptr2sch->schedule(Event::callback<Traffic,
+        &Traffic::new_packet>(time_arrival, this));
   }
   
 }
@@ -235,8 +237,8 @@ BEGIN_PROF("Traffic::new_packet")
   ++n_created_packs;
 
   timestamp time_arrival = ptr2sch->now();
-  MSDU pck(packlength_prob.new_value(randgen->uniform()), source, target, 0,
-           time_arrival);
+  MSDU pck(ctx, packlength_prob.new_value(randgen->uniform()), source, target,
+           0, time_arrival);
 
   if (logflag) *mylog << "\n" << ptr2sch->now() << "sec., " << *source 
                       << " generates a new packet for " << *target << " with " 
@@ -251,8 +253,8 @@ BEGIN_PROF("Traffic::new_packet")
                    break;
   }
 
-  ptr2sch->schedule(Event(time_arrival, (void*)(&wrapper_to_new_packet),
-                          (void*)this));
+  ptr2sch->schedule(Event::callback<Traffic,
+      &Traffic::new_packet>(time_arrival, this));
 
 END_PROF("Traffic::new_packet")
 }
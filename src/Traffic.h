@@ -31,6 +31,7 @@
 #include "log.h"
 
 class Terminal;
+class SimContext;
 
 ////////////////////////////////////////////////////////////////////////////////
 // enum arrival_time_type                                                     //
@@ -104,6 +105,7 @@ struct traffic_struct {
 class Traffic {
   Scheduler* ptr2sch; // pointer to simulation scheduler
   random*    randgen; // pointer to random number generator
+  SimContext* ctx;    // pointer to simulation context
   log_file*  mylog;   // pointer to log file
   bool       logflag;
 
@@ -123,16 +125,13 @@ class Traffic {
 public:
   Traffic(Scheduler* s,          // pointer to simulation scheduler
           random* r,             // pointer to random number generator
+          SimContext* x,         // pointer to simulation context
           log_file* l,           // pointer to log file
           Terminal* from,        // source terminal
           Terminal* to,          // target terminal
           traffic_struct tr      // traffic parameters
           );
 
-  static void wrapper_to_new_packet (void* ptr2obj) {
-    ((Traffic*)ptr2obj)->new_packet();}
-  // wrapper function to schedule next packet transmission
-
   virtual ~Traffic() {};
 
 };
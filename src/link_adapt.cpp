@@ -23,7 +23,7 @@
 #include "link_adapt.h"
 #include "Terminal.h"
 #include "Profiler.h"
-#include "Standard.h"
+#include "SimContext.h"
 
 unsigned LA_max_success_counter_LOW = 10;
 unsigned LA_max_success_counter_HIGH = 3;
@@ -67,10 +67,11 @@ istream& operator>> (istream& is, adapt_mode& tm) {
 // constructor                                                                //
 ////////////////////////////////////////////////////////////////////////////////
 link_adapt::link_adapt (Terminal* from, Terminal* to, adapt_struct param,
-                        log_file* l) {
+                        SimContext* x, log_file* l) {
 
   source = from;
   target = to;
+  ctx = x;
 
   mylog = l;
   logflag = (*mylog)(log_type::adapt);
@@ -316,7 +317,7 @@ BEGIN_PROF("link_adapt::success")
     succeed_counter = 0;
     
     if (adapt == RATE || power_dBm - pstep_d < pmin) {
-      if(current_mode != Standard::get_maxMCS()) ++current_mode;
+      if(current_mode != ctx->standard.get_maxMCS()) ++current_mode;
 
       if (logflag) *mylog << "    increase tx rate to " << current_mode << endl;
     } else {
@@ -89,6 +89,7 @@ public:
   link_adapt(Terminal* from,      // link between terminal *from
              Terminal* to,        // and *to
              adapt_struct param,  // link adaptation parameters
+             SimContext* x,       // pointer to simulation context
              log_file* l          // pointer to log class
              );
 
@@ -27,6 +27,7 @@
 #include "log.h"
 
 class Terminal;
+class SimContext;
 
 ////////////////////////////////////////////////////////////////////////////////
 // enum adapt_mode                                                            //
@@ -49,6 +50,8 @@ protected:
   Terminal* source;  // link between terminals *source
   Terminal* target;  // and *target
 
+  SimContext* ctx;   // pointer to simulation context
+
   log_file*  mylog;
   bool       logflag;  // true if link adaptation events should be logged
 
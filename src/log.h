@@ -69,6 +69,8 @@ public:
 
   
   inline bool operator() (log_type i) const {return i & log_flag;}  
+
+  inline bool active() const {return log_flag;} // true if anything is logged
   
 };
 
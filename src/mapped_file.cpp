@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2002-2015 by Microwave and Wireless Systems Laboratory, by Andre Barreto and Calil Queiroz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#include "mapped_file.h"
+#include "myexception.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// mapped_file constructor                                                    //
+////////////////////////////////////////////////////////////////////////////////
+#ifdef _WIN32
+mapped_file::mapped_file(const string& name) : ptr(0), len(0), map_handle(0) {
+  file_handle = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if (file_handle == INVALID_HANDLE_VALUE) throw my_exception(OPENFILE, name);
+
+  LARGE_INTEGER sz;
+  if (GetFileSizeEx(file_handle, &sz)) len = size_t(sz.QuadPart);
+
+  if (len) {
+    map_handle = CreateFileMappingA(file_handle, NULL, PAGE_READONLY, 0, 0,
+                                    NULL);
+    if (map_handle)
+      ptr = (const char*) MapViewOfFile(map_handle, FILE_MAP_READ, 0, 0, 0);
+  }
+
+  if (!ptr) {
+    if (map_handle) CloseHandle(map_handle);
+    CloseHandle(file_handle);
+    throw my_exception(OPENFILE, name);
+  }
+}
+#else
+mapped_file::mapped_file(const string& name) : ptr(0), len(0) {
+  int fd = open(name.c_str(), O_RDONLY);
+  if (fd < 0) throw my_exception(OPENFILE, name);
+
+  struct stat st;
+  if (fstat(fd, &st) == 0) len = size_t(st.st_size);
+
+  void* p = MAP_FAILED;
+  if (len) p = mmap(0, len, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping remains valid after the file is closed
+
+  if (p == MAP_FAILED) throw my_exception(OPENFILE, name);
+  ptr = (const char*) p;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// mapped_file destructor                                                     //
+////////////////////////////////////////////////////////////////////////////////
+mapped_file::~mapped_file() {
+#ifdef _WIN32
+  UnmapViewOfFile(ptr);
+  CloseHandle(map_handle);
+  CloseHandle(file_handle);
+#else
+  munmap((void*) ptr, len);
+#endif
+}
@@ -0,0 +1,62 @@
+/*
+* Copyright (c) 2002-2015 by Microwave and Wireless Systems Laboratory, by Andre Barreto and Calil Queiroz
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in
+* all copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+* THE SOFTWARE.
+*/
+
+#ifndef _mapped_file_h
+#define _mapped_file_h 1
+
+#include <string>
+
+using namespace std;
+
+////////////////////////////////////////////////////////////////////////////////
+// class mapped_file                                                          //
+//                                                                            //
+// read-only view of a file mapped into memory                                //
+//                                                                            //
+// Usage:                                                                     //
+// - the constructor maps the whole file 'name' and throws an OPENFILE        //
+//   exception if this is not possible. Pages are loaded by the operating     //
+//   system when accessed, so that large files need not fit into memory.      //
+// - 'data' returns the address of the first byte and 'size' the file length. //
+// - the file is unmapped by the destructor. Objects cannot be copied.        //
+////////////////////////////////////////////////////////////////////////////////
+class mapped_file {
+  const char* ptr;
+  size_t len;
+
+#ifdef _WIN32
+  void* file_handle;
+  void* map_handle;
+#endif
+
+  mapped_file(const mapped_file&);
+  mapped_file& operator= (const mapped_file&);
+
+public:
+  explicit mapped_file(const string& name);
+  ~mapped_file();
+
+  const char* data() const {return ptr;}
+  size_t size() const {return len;}
+};
+
+#endif
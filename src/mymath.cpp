@@ -21,11 +21,17 @@
 */
 
 #include "mymath.h"
+#include "myexception.h"
 
 #include <math.h>
 #include <stdlib.h>
+#include <string.h>
 #include <iostream>
 
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
+
 using namespace std;
 
 ////////////////////////////////////////////////////
@@ -62,83 +68,138 @@ double bessel_j0 (double x){
   return ans;
 }
 
-/*
- FFT/IFFT routine.
-
- Inputs:
-	indata[] : array of complex* data points of size 2*NFFT+1.
-		indata[0] is unused,
-		* the n'th complex number x(n), for 0 <= n <= length(x)-1, is stored as:
-			indata[2*n+1] = real(x(n))
-			indata[2*n+2] = imag(x(n))
-		if length(Nx) < NFFT, the remainder of the array must be padded with zeros
-
-	nn : FFT order NFFT. This MUST be a power of 2 and >= length(x).
-	isign:  if set to 1,
-				computes the forward FFT
-			if set to -1,
-				computes Inverse FFT - in this case the output values have
-				to be manually normalized by multiplying with 1/NFFT.
- Outputs:
-	data[] : The FFT or IFFT results are stored in data
-
- Algorithm adapted from
-    "Numerical Methods in C",
-    Press, Teukolsky, Vetterling, Flannery
-*/
+////////////////////////////////////////////////////
+// bessel_j0_limit
+//
+// returns the largest x in [0, 2.4] for which
+// bessel_j0(x) >= y, obtained by bisection.
+// J_0 decreases from 1 to approximately 0 in this
+// interval.
+////////////////////////////////////////////////////
+double bessel_j0_limit (double y){
+  double lo = 0, hi = 2.4;
 
-valarray<double> four1(valarray<double> indata, int nn, int isign)
-		{
-	int n, mmax, m, j, istep, i;
-	double wtemp, wr, wpr, wpi, wi, theta;
-	double tempr, tempi;
-	valarray<double> data;
-
-	data.resize(indata.size(),0.0);
-	data = indata;
-
-	n = nn << 1;
-	j = 1;
-	for (i = 1; i < n; i += 2) {
-		if (j > i) {
-			tempr = data[j];     data[j] = data[i];     data[i] = tempr;
-			tempr = data[j+1]; data[j+1] = data[i+1]; data[i+1] = tempr;
-		}
-		m = n >> 1;
-		while (m >= 2 && j > m) {
-			j -= m;
-			m >>= 1;
+  if (bessel_j0(hi) >= y) return hi;
+
+  for (int i = 0; i < 64; i++) {
+    double mid = 0.5*(lo + hi);
+    if (mid <= lo || mid >= hi) break;
+    if (bessel_j0(mid) >= y) lo = mid;
+    else hi = mid;
+  }
+  return lo;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class fft_plan                                                             //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// fft_plan constructor                                                       //
+//                                                                            //
+// precomputes bit-reversal permutation and twiddle factors                   //
+////////////////////////////////////////////////////////////////////////////////
+fft_plan::fft_plan(unsigned nn) : n(nn) {
+	if (n < 4 || (n & (n-1)))
+		throw my_exception(GENERAL, "FFT length must be a power of 2");
+
+	unsigned m = n/2;
+
+	// bit-reversal permutation of m complex values
+	for (unsigned i = 0, j = 0; i < m; ++i) {
+		if (j > i) swaps.push_back(make_pair(i,j));
+		unsigned b = m >> 1;
+		while (b && (j & b)) {
+			j ^= b;
+			b >>= 1;
 		}
-		j += m;
+		j |= b;
+	}
+
+	// twiddle factors of the complex FFT of length m
+	tw_re.resize(m/2);
+	tw_im.resize(m/2);
+	for (unsigned k = 0; k < m/2; ++k) {
+		tw_re[k] = cos(TWOPI*k/m);
+		tw_im[k] = sin(TWOPI*k/m);
 	}
-	mmax = 2;
-	while (n > mmax) {
-		istep = 2*mmax;
-		theta = TWOPI/(isign*mmax);
-		wtemp = sin(0.5*theta);
-		wpr = -2.0*wtemp*wtemp;
-		wpi = sin(theta);
-		wr = 1.0;
-		wi = 0.0;
-		for (m = 1; m < mmax; m += 2) {
-			for (i = m; i <= n; i += istep) {
-				j =i + mmax;
-				tempr = wr*data[j]   - wi*data[j+1];
-				tempi = wr*data[j+1] + wi*data[j];
-				if(j >= 2*nn) cout << " " << nn;
-				data[j]   = data[i]   - tempr;
-				data[j+1] = data[i+1] - tempi;
-				data[i] += tempr;
-				data[i+1] += tempi;
+
+	// twiddle factors to split the real-input spectrum
+	split_re.resize(m+1);
+	split_im.resize(m+1);
+	for (unsigned k = 0; k <= m; ++k) {
+		split_re[k] = cos(TWOPI*k/n);
+		split_im[k] = sin(TWOPI*k/n);
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// fft_plan::transform                                                        //
+//                                                                            //
+// calculates the FFT of the n real values 'x' as a complex FFT of length n/2 //
+// of the even and odd samples. The result is stored in 'z' (n/2 complex      //
+// values, real and imaginary parts interleaved) and must be read with 'abs'. //
+////////////////////////////////////////////////////////////////////////////////
+void fft_plan::transform(const double* x, double* z) const {
+	unsigned m = n/2;
+
+	for (unsigned i = 0; i < n; ++i) z[i] = x[i];
+
+	for (vector< pair<unsigned,unsigned> >::const_iterator it = swaps.begin();
+	     it != swaps.end(); ++it) {
+		unsigned a = 2*it->first;
+		unsigned b = 2*it->second;
+		swap(z[a], z[b]);
+		swap(z[a+1], z[b+1]);
+	}
+
+	for (unsigned len = 2; len <= m; len <<= 1) {
+		unsigned half = len/2;
+		unsigned step = m/len;
+		for (unsigned i = 0; i < m; i += len) {
+			for (unsigned j = 0; j < half; ++j) {
+				double wr = tw_re[j*step];
+				double wi = tw_im[j*step];
+				double* u = z + 2*(i+j);
+				double* v = z + 2*(i+j+half);
+				double tr = wr*v[0] - wi*v[1];
+				double ti = wr*v[1] + wi*v[0];
+				v[0] = u[0] - tr;
+				v[1] = u[1] - ti;
+				u[0] += tr;
+				u[1] += ti;
 			}
-			wr = (wtemp = wr)*wpr - wi*wpi + wr;
-			wi = wi*wpr + wtemp*wpi + wi;
 		}
-		mmax = istep;
 	}
+}
 
-	return data;
-		}
+////////////////////////////////////////////////////////////////////////////////
+// fft_plan::abs                                                              //
+//                                                                            //
+// returns the absolute value of the 'k'-th FFT coefficient, 0 <= k < n,      //
+// from the result 'z' of 'transform'                                         //
+////////////////////////////////////////////////////////////////////////////////
+double fft_plan::abs(const double* z, unsigned k) const {
+	unsigned m = n/2;
+
+	// spectrum of real input is symmetric
+	if (k > m) k = n - k;
+
+	unsigned k1 = (k == m)? 0 : k;
+	unsigned k2 = (k == 0)? 0 : m - k;
+
+	// spectra of even (e) and odd (o) samples
+	double er = 0.5 * (z[2*k1] + z[2*k2]);
+	double ei = 0.5 * (z[2*k1+1] - z[2*k2+1]);
+	double or_ = 0.5 * (z[2*k1+1] + z[2*k2+1]);
+	double oi = -0.5 * (z[2*k1] - z[2*k2]);
+
+	double xr = er + split_re[k]*or_ - split_im[k]*oi;
+	double xi = ei + split_re[k]*oi + split_im[k]*or_;
+
+	return sqrt(xr*xr + xi*xi);
+}
 
 double invraisedcos(double t, double W, double rollof) {
 	double y;
@@ -153,6 +214,151 @@ double invraisedcos(double t, double W, double rollof) {
 
 }
 
+////////////////////////////////////////////////////////////////////////////////
+////////////////////////////////////////////////////////////////////////////////
+// class raisedcos_table                                                      //
+////////////////////////////////////////////////////////////////////////////////
+
+////////////////////////////////////////////////////////////////////////////////
+// raisedcos_table constructor                                                //
+//                                                                            //
+// calculates the interpolation coefficients of all taps, whose delays are    //
+// given in increasing order                                                  //
+////////////////////////////////////////////////////////////////////////////////
+raisedcos_table::raisedcos_table(const valarray<double>& delay, double W,
+                                 double rollof) {
+	double sample_time = 1/W;
+
+	n_taps = delay.size();
+	n_samp = (unsigned)ceil(delay[n_taps - 1]/sample_time) + 1;
+
+	coef.resize(n_taps * n_samp);
+	for(unsigned j = 0; j < n_taps; j++) {
+		for(unsigned k = 0; k < n_samp; k++) {
+			coef[j*n_samp + k] = invraisedcos(k*sample_time - delay[j], W, rollof);
+		}
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// raisedcos_table::interpolate                                               //
+//                                                                            //
+// the inner loop runs over contiguous samples, so that it can be vectorized  //
+// by the compiler. Taps are added in increasing order for each sample.       //
+////////////////////////////////////////////////////////////////////////////////
+void raisedcos_table::interpolate(const valarray<double>& amp, double* x) const {
+	for(unsigned k = 0; k < n_samp; k++) x[k] = 0.0;
+
+	const double* c = &coef[0];
+	for(unsigned j = 0; j < n_taps; j++, c += n_samp) {
+		double a = amp[j];
+		for(unsigned k = 0; k < n_samp; k++) x[k] += a * c[k];
+	}
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+#ifdef __AVX2__
+////////////////////////////////////////////////////////////////////////////////
+// fast exponential                                                           //
+//                                                                            //
+// x = n + f with integer n and |f| <= 1/2. 2^f = e^(f*ln2) is given by its   //
+// Taylor polynomial of degree 11, and n is added to the exponent bits. n is  //
+// obtained by adding 1.5*2^52 to x, so that it appears in the lowest bits.   //
+// 'exp2_1' is used for the last elements of an array, so that all elements   //
+// are calculated with the same algorithm.                                    //
+////////////////////////////////////////////////////////////////////////////////
+static const double exp2_round = 6755399441055744.0; // 1.5*2^52
+static const double exp2_min = -1020.0;
+static const double exp2_max = 1020.0;
+
+// 1/k!, k = 11,...,0
+static const double exp2_coef[12] = {2.50521083854417187751e-08,
+	2.75573192239858906526e-07, 2.75573192239858906526e-06,
+	2.48015873015873015873e-05, 1.98412698412698412698e-04,
+	1.38888888888888888889e-03, 8.33333333333333333333e-03,
+	4.16666666666666666667e-02, 1.66666666666666666667e-01, 0.5, 1.0, 1.0};
+
+static inline __m256d exp2_4(__m256d x) {
+	__m256d xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(exp2_min)),
+			_mm256_set1_pd(exp2_max));
+	__m256d t = _mm256_add_pd(xc, _mm256_set1_pd(exp2_round));
+	__m256d f = _mm256_mul_pd(_mm256_sub_pd(xc,
+			_mm256_sub_pd(t, _mm256_set1_pd(exp2_round))), _mm256_set1_pd(M_LN2));
+
+	__m256d p = _mm256_set1_pd(exp2_coef[0]);
+	for (unsigned k = 1; k < 12; k++)
+		p = _mm256_add_pd(_mm256_mul_pd(p, f), _mm256_set1_pd(exp2_coef[k]));
+
+	p = _mm256_castsi256_pd(_mm256_add_epi64(_mm256_castpd_si256(p),
+			_mm256_slli_epi64(_mm256_castpd_si256(t), 52)));
+
+	// out of range and NaN
+	p = _mm256_blendv_pd(p, _mm256_setzero_pd(),
+			_mm256_cmp_pd(x, _mm256_set1_pd(exp2_min), _CMP_LT_OQ));
+	p = _mm256_blendv_pd(p, _mm256_set1_pd(HUGE_VAL),
+			_mm256_cmp_pd(x, _mm256_set1_pd(exp2_max), _CMP_GT_OQ));
+	return _mm256_blendv_pd(p, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+static inline double exp2_1(double x) {
+	if (x != x) return x;
+	if (x < exp2_min) return 0.0;
+	if (x > exp2_max) return HUGE_VAL;
+
+	double t = x + exp2_round;
+	double f = (x - (t - exp2_round)) * M_LN2;
+
+	double p = exp2_coef[0];
+	for (unsigned k = 1; k < 12; k++) p = p*f + exp2_coef[k];
+
+	long long bp, bt;
+	memcpy(&bp, &p, sizeof(p));
+	memcpy(&bt, &t, sizeof(t));
+	bp += bt << 52;
+	memcpy(&p, &bp, sizeof(p));
+	return p;
+}
+#endif
+
+////////////////////////////////////////////////////////////////////////////////
+// exp2_array                                                                 //
+////////////////////////////////////////////////////////////////////////////////
+void exp2_array(const double* x, double* y, unsigned n) {
+#ifdef _CHECK_FAST_MATH_
+	vector<double> arg(x, x + n); // 'x' may be overwritten
+#endif
+
+	unsigned k = 0;
+#ifdef __AVX2__
+	for (; k + 4 <= n; k += 4)
+		_mm256_storeu_pd(y + k, exp2_4(_mm256_loadu_pd(x + k)));
+	for (; k < n; k++) y[k] = exp2_1(x[k]);
+#else
+	for (; k < n; k++) y[k] = exp2(x[k]);
+#endif
+
+#ifdef _CHECK_FAST_MATH_
+	for (k = 0; k < n; k++) {
+		double ref = exp2(arg[k]);
+		if (ref != ref && y[k] != y[k]) continue;
+		if (arg[k] < -1020.0 && y[k] == 0) continue;
+		if (arg[k] > 1020.0 && y[k] == HUGE_VAL) continue;
+		if (fabs(y[k] - ref) <= 2e-14 * ref) continue;
+		throw my_exception(GENERAL, "exp2_array exceeds error bound");
+	}
+#endif
+}
+
 double myabs(double r, double i){
 	return sqrt(pow(r,2) + pow(i,2));
 }
+
+unsigned long long hash_bytes(const void* p, size_t n, unsigned long long h) {
+	const unsigned char* c = (const unsigned char*) p;
+	for (size_t k = 0; k < n; k++) {
+		h ^= c[k];
+		h *= 1099511628211ULL;
+	}
+	return h;
+}
@@ -24,6 +24,8 @@
 #define _mymath_h 1
 
 #include <valarray>
+#include <vector>
+#include <utility>
 
 using namespace std;
 
@@ -33,8 +35,92 @@ using namespace std;
 #define TWOPI	(2.0*PI)
 
 double bessel_j0 (double x);
-valarray<double> four1(valarray<double> indata, int nn, int isign);
+double bessel_j0_limit (double y);
 double invraisedcos(double t, double W, double rollof);
 double myabs(double r, double i);
 
+////////////////////////////////////////////////////////////////////////////////
+// exp2_array                                                                 //
+//                                                                            //
+// calculates y[k] = 2^x[k] for 'n' doubles, e.g., for dB to linear           //
+// conversion, 10^(x/10) = 2^(x * dB_to_log2). 'x' and 'y' may be the same    //
+// array. If the compiler targets AVX2 (__AVX2__ defined), four values are    //
+// calculated at once by a polynomial approximation with relative error below //
+// 2e-14; results below 2^-1020 are 0 and results above 2^1020 are infinite.  //
+// Otherwise, the C library is employed.                                      //
+// If _CHECK_FAST_MATH_ is defined, all results are compared to the C library //
+// and an exception is thrown if the error exceeds this bound.                //
+////////////////////////////////////////////////////////////////////////////////
+void exp2_array(const double* x, double* y, unsigned n);
+
+const double dB_to_log2 = 0.33219280948873623479; // log2(10)/10
+
+const unsigned long long hash_init = 14695981039346656037ULL;
+unsigned long long hash_bytes(const void* p, size_t n,
+                              unsigned long long h = hash_init);
+// returns FNV-1a hash of 'n' bytes at 'p', continuing from hash value 'h'
+
+////////////////////////////////////////////////////////////////////////////////
+// class fft_plan                                                             //
+//                                                                            //
+// FFT of real data with a fixed power-of-2 length 'n' >= 4                   //
+//                                                                            //
+// Usage:                                                                     //
+// - bit-reversal permutation and twiddle factors are calculated once by the  //
+//   constructor, so that a plan should be reused for all transforms of the   //
+//   same length.                                                             //
+// - 'transform' calculates the spectrum X[k] = sum_j x[j] exp(i*2*pi*j*k/n)  //
+//   into a buffer of n doubles supplied by the caller, without allocating    //
+//   memory. 'abs' returns |X[k]| from this buffer.                           //
+////////////////////////////////////////////////////////////////////////////////
+class fft_plan {
+	unsigned n;
+
+	vector< pair<unsigned,unsigned> > swaps; // bit-reversal permutation
+	vector<double> tw_re, tw_im;       // twiddle factors for length n/2
+	vector<double> split_re, split_im; // twiddle factors for length n
+
+public:
+	explicit fft_plan(unsigned nn);
+
+	unsigned size() const {return n;}
+
+	void transform(const double* x, double* z) const;
+	// calculates FFT of 'x' (n doubles) into 'z' (n doubles)
+
+	double abs(const double* z, unsigned k) const;
+	// returns absolute value of 'k'-th coefficient, given output 'z' of
+	// 'transform'
+};
+
+////////////////////////////////////////////////////////////////////////////////
+// class raisedcos_table                                                      //
+//                                                                            //
+// interpolation of multipath taps at the sampling instants of a channel with //
+// bandwidth 'W' using a raised-cosine pulse                                  //
+//                                                                            //
+// Usage:                                                                     //
+// - the constructor calculates invraisedcos(k/W - delay[j], W, rollof) for   //
+//   all taps 'j' and samples 'k' = 0,...,'max_samp'. The table depends only  //
+//   on the tap delays and on the standard, and should be shared by all links //
+//   with the same multipath model.                                           //
+// - 'interpolate' calculates the time-domain samples from the tap amplitudes //
+//   as a matrix-vector product into a buffer supplied by the caller.         //
+////////////////////////////////////////////////////////////////////////////////
+class raisedcos_table {
+	unsigned n_taps;
+	unsigned n_samp; // number of samples, 'max_samp' + 1
+
+	vector<double> coef; // coefficients of tap 'j' at 'coef[j*n_samp]'
+
+public:
+	raisedcos_table(const valarray<double>& delay, double W, double rollof);
+
+	unsigned max_samp() const {return n_samp - 1;}
+	// returns index of last nonzero time-domain sample
+
+	void interpolate(const valarray<double>& amp, double* x) const;
+	// calculates samples 0,...,'max_samp' into 'x' from tap amplitudes 'amp'
+};
+
 #endif